@@ -0,0 +1,29 @@
+#include "authentication.hpp"
+#include <azure/core/url.hpp>
+
+using namespace std;
+
+namespace az {
+Authentication GetAuthentication(const Config &config,
+                                 const string &sServiceUrl, bool bEmulated) {
+  if (bEmulated)
+    return Authentication::EMULATOR_KEY;
+  if (config.sStorageAccountKey.empty() && config.sStorageSasToken.empty())
+    return Authentication::STORAGE_TOKEN;
+  if (!config.sStorageAccountName.empty()) {
+    // the account name is the first label of the host name
+    string sHost = Azure::Core::Url(sServiceUrl).GetHost();
+    if (sHost.substr(0, sHost.find('.')) != config.sStorageAccountName)
+      return Authentication::STORAGE_TOKEN;
+  }
+  return config.sStorageAccountKey.empty() ? Authentication::SAS_TOKEN
+                                           : Authentication::ACCOUNT_KEY;
+}
+
+string GetServiceClientUrl(const Config &config, const string &sServiceUrl,
+                           Authentication authentication) {
+  if (authentication == Authentication::SAS_TOKEN)
+    return sServiceUrl + "?" + config.sStorageSasToken;
+  return sServiceUrl;
+}
+} // namespace az
@@ -0,0 +1,30 @@
+// Choice of the credential with which the requests to a storage service URL
+// are authenticated, from the configuration alone so that it can be tested
+// without a service.
+
+#pragma once
+
+#include "config.hpp"
+#include <string>
+
+namespace az {
+enum class Authentication {
+  EMULATOR_KEY,  // shared key of the emulator's connection string
+  ACCOUNT_KEY,   // shared key of the configuration
+  SAS_TOKEN,     // SAS token of the configuration, appended to the URLs
+  STORAGE_TOKEN, // Azure AD token for the storage scope
+};
+
+// Requests to the emulator are signed with its key. Requests to a cloud
+// account are signed with the account key or the SAS token of the
+// configuration, if the configuration has one and is not scoped to another
+// account by its account name, and are given storage tokens otherwise.
+Authentication GetAuthentication(const Config &config,
+                                 const std::string &sServiceUrl,
+                                 bool bEmulated);
+
+// URL from which the service client of a service URL is created
+std::string GetServiceClientUrl(const Config &config,
+                                const std::string &sServiceUrl,
+                                Authentication authentication);
+} // namespace az
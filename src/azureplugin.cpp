@@ -294,6 +294,32 @@ int driver_copyFromLocal(const char *sSourceUrl, const char *sDestUrl) {
   })
 }
 
+int driver_copyAllToLocal(const char *sSourceUrl, const char *sDestDir) {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Copying files matching URL {} to directory {}", sSourceUrl,
+                  sDestDir);
+    if (!sSourceUrl)
+      throw NullArgError(__func__, STRINGIFY(sSourceUrl));
+    if (!sDestDir)
+      throw NullArgError(__func__, STRINGIFY(sDestDir));
+    driver.CopyAllTo(sSourceUrl, sDestDir);
+    return nSuccess;
+  })
+}
+
+int driver_copyAllFromLocal(const char *sSourceDir, const char *sDestUrl) {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Copying files of directory {} to URL {}", sSourceDir,
+                  sDestUrl);
+    if (!sSourceDir)
+      throw NullArgError(__func__, STRINGIFY(sSourceDir));
+    if (!sDestUrl)
+      throw NullArgError(__func__, STRINGIFY(sDestUrl));
+    driver.CopyAllFrom(sDestUrl, sSourceDir);
+    return nSuccess;
+  })
+}
+
 int driver_concat(const char *destfilename, const char **sourcefilenames,
                   size_t sourcefilecount) {
   HANDLE_ERRORS(nFailure, {
@@ -314,3 +340,56 @@ int driver_concat(const char *destfilename, const char **sourcefilenames,
     return nSuccess;
   })
 }
+
+int driver_sync() {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Waiting for the files being closed");
+    driver.Sync();
+    return nSuccess;
+  })
+}
+
+int driver_copy(const char *sSourceUrl, const char *sDestUrl) {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Copying file at URL {} to URL {}", sSourceUrl, sDestUrl);
+    if (!sSourceUrl)
+      throw NullArgError(__func__, STRINGIFY(sSourceUrl));
+    if (!sDestUrl)
+      throw NullArgError(__func__, STRINGIFY(sDestUrl));
+    driver.Copy(sSourceUrl, sDestUrl);
+    return nSuccess;
+  })
+}
+
+int driver_move(const char *sSourceUrl, const char *sDestUrl) {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Moving file at URL {} to URL {}", sSourceUrl, sDestUrl);
+    if (!sSourceUrl)
+      throw NullArgError(__func__, STRINGIFY(sSourceUrl));
+    if (!sDestUrl)
+      throw NullArgError(__func__, STRINGIFY(sDestUrl));
+    driver.Move(sSourceUrl, sDestUrl);
+    return nSuccess;
+  })
+}
+
+void *driver_fopenPart(const char *sUrl, long long int nPart) {
+  HANDLE_ERRORS(nullptr, {
+    spdlog::debug("Opening part {} of file at URL {}", nPart, sUrl);
+    if (!sUrl)
+      throw NullArgError(__func__, STRINGIFY(sUrl));
+    if (nPart < 0)
+      throw invalid_argument("part index must be non-negative");
+    return driver.OpenPartForWriting(sUrl, (size_t)nPart).GetHandle();
+  })
+}
+
+int driver_commitParts(const char *sUrl) {
+  HANDLE_ERRORS(nFailure, {
+    spdlog::debug("Committing the parts of file at URL {}", sUrl);
+    if (!sUrl)
+      throw NullArgError(__func__, STRINGIFY(sUrl));
+    driver.CommitParts(sUrl);
+    return nSuccess;
+  })
+}
@@ -142,12 +142,49 @@ VISIBLE int driver_copyToLocal(const char *sourcefilename,
 VISIBLE int driver_copyFromLocal(const char *sourcefilename,
                                  const char *destfilename);
 
+// Copies all the files matching sourcefilepattern, which is on the current
+// file system, to the local directory destdirname, at their path relative to
+// the directory of the pattern. Returns 1 on success, 0 on error
+VISIBLE int driver_copyAllToLocal(const char *sourcefilepattern,
+                                  const char *destdirname);
+
+// Copies all the files of the local directory sourcedirname, recursively, to
+// the directory destdirname of the current file system, at their relative
+// path. Returns 1 on success, 0 on error
+VISIBLE int driver_copyAllFromLocal(const char *sourcedirname,
+                                    const char *destdirname);
+
 // Concatenates all sourcefilecount files specified in sourcefilenames to a new
 // file destfilename The concatenation is done on the storage server side The
 // source files are not deleted Returns 1 on success, 0 on error
 VISIBLE int driver_concat(const char *destfilename,
                           const char **sourcefilenames, size_t sourcefilecount);
 
+// Waits for the files closed in the background, when the driver closes them
+// asynchronously (AZURE_ASYNC_CLOSE) Returns 1 if they were all successfully
+// written, 0 otherwise
+VISIBLE int driver_sync();
+
+// Copies sourcefilename to destfilename, both on the current file system, on
+// the storage server side. Returns 1 on success, 0 on error
+VISIBLE int driver_copy(const char *sourcefilename, const char *destfilename);
+
+// Moves sourcefilename to destfilename, both on the current file system, on
+// the storage server side. Returns 1 on success, 0 on error
+VISIBLE int driver_move(const char *sourcefilename, const char *destfilename);
+
+// Opens for writing the part of index part of the file filename, written by
+// several writers possibly running in different processes. The parts written
+// and closed only become the content of the file, in the order of their
+// indices, once committed by driver_commitParts. Only supported by blobs.
+// Returns the stream on success, a null pointer otherwise
+VISIBLE void *driver_fopenPart(const char *filename, long long int part);
+
+// Makes the file filename the concatenation of the parts written to it with
+// driver_fopenPart and closed, replacing its previous content
+// Returns 1 on success, 0 on error
+VISIBLE int driver_commitParts(const char *filename);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
@@ -0,0 +1,109 @@
+#include "blockid.hpp"
+#include <algorithm>
+#include <azure/core/base64.hpp>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+using namespace std;
+
+namespace az {
+// Layout of the part and upload block IDs: numbers in base 10 after a marker
+// distinguishing them from each other and from the IDs made by MakeBlockId
+static constexpr size_t nBlockIdLength = 64;
+static constexpr char cPartMarker = 'p';
+static constexpr char cUploadMarker = 'u';
+static constexpr int nPartDigits = 15;
+static constexpr int nAttemptDigits = 20;
+static constexpr int nPartBlockIndexDigits = 28;
+static constexpr int nFileSizeDigits = 15;
+static constexpr int nModificationTimeDigits = 20;
+static constexpr int nBlockSizeDigits = 10;
+static constexpr int nUploadBlockIndexDigits = 18;
+
+static string EncodeBlockId(const string &sBlockIdInBase10) {
+  vector<uint8_t> blockIdInBase10(sBlockIdInBase10.begin(),
+                                  sBlockIdInBase10.end());
+  return Azure::Core::Convert::Base64Encode(blockIdInBase10);
+}
+
+static string DecodeBlockId(const string &sBlockId) {
+  vector<uint8_t> blockIdInBase10 =
+      Azure::Core::Convert::Base64Decode(sBlockId);
+  return string(blockIdInBase10.begin(), blockIdInBase10.end());
+}
+
+string MakeBlockId(size_t nBlockIndex) {
+  ostringstream os;
+  os << setfill('0') << setw(nBlockIdLength) << nBlockIndex;
+  return EncodeBlockId(os.str());
+}
+
+size_t GetNextBlockIndex(const vector<string> &blockIds) {
+  size_t nNextBlockIndex = blockIds.size();
+  for (const auto &sBlockId : blockIds) {
+    try {
+      string sBlockIdInBase10 = DecodeBlockId(sBlockId);
+      if (sBlockIdInBase10.size() == nBlockIdLength &&
+          sBlockIdInBase10.find_first_not_of("0123456789") == string::npos)
+        nNextBlockIndex = max(nNextBlockIndex,
+                              (size_t)stoull(sBlockIdInBase10) + 1);
+    } catch (const exception &) {
+      // not a block ID of this driver
+    }
+  }
+  return nNextBlockIndex;
+}
+
+string MakePartBlockId(size_t nPart, uint64_t nAttempt, size_t nBlockIndex) {
+  ostringstream os;
+  os << cPartMarker << setfill('0') << setw(nPartDigits) << nPart
+     << setw(nAttemptDigits) << nAttempt << setw(nPartBlockIndexDigits)
+     << nBlockIndex;
+  return EncodeBlockId(os.str());
+}
+
+string MakeUploadBlockId(size_t nFileSize, uint64_t nModificationTime,
+                         size_t nBlockSize, size_t nBlockIndex) {
+  ostringstream os;
+  os << cUploadMarker << setfill('0') << setw(nFileSizeDigits) << nFileSize
+     << setw(nModificationTimeDigits) << nModificationTime
+     << setw(nBlockSizeDigits) << nBlockSize << setw(nUploadBlockIndexDigits)
+     << nBlockIndex;
+  return EncodeBlockId(os.str());
+}
+
+vector<string> GetPartBlockIds(const vector<string> &blockIds) {
+  // (part, attempt, index) of each part block ID
+  vector<pair<tuple<size_t, uint64_t, size_t>, string>> partBlocks;
+  map<size_t, uint64_t> lastAttempts;
+  for (const auto &sBlockId : blockIds) {
+    try {
+      string sBlockIdInBase10 = DecodeBlockId(sBlockId);
+      if (sBlockIdInBase10.size() != nBlockIdLength ||
+          sBlockIdInBase10[0] != cPartMarker ||
+          sBlockIdInBase10.find_first_not_of("0123456789", 1) != string::npos)
+        continue;
+      size_t nPart = stoull(sBlockIdInBase10.substr(1, nPartDigits));
+      uint64_t nAttempt =
+          stoull(sBlockIdInBase10.substr(1 + nPartDigits, nAttemptDigits));
+      size_t nBlockIndex =
+          stoull(sBlockIdInBase10.substr(1 + nPartDigits + nAttemptDigits));
+      partBlocks.emplace_back(make_tuple(nPart, nAttempt, nBlockIndex),
+                              sBlockId);
+      lastAttempts[nPart] = max(lastAttempts[nPart], nAttempt);
+    } catch (const exception &) {
+      // not a block ID of this driver
+    }
+  }
+
+  sort(partBlocks.begin(), partBlocks.end());
+  vector<string> orderedBlockIds;
+  for (const auto &partBlock : partBlocks) {
+    if (get<1>(partBlock.first) == lastAttempts[get<0>(partBlock.first)])
+      orderedBlockIds.push_back(partBlock.second);
+  }
+  return orderedBlockIds;
+}
+} // namespace az
@@ -0,0 +1,31 @@
+// Block IDs of the block blobs written by the driver. They all have the same
+// length, as required by the service for the blocks of a blob.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace az {
+std::string MakeBlockId(size_t nBlockIndex);
+// Returns the index following the largest index of the block IDs made by
+// MakeBlockId, for the writer to never reuse any of them
+size_t GetNextBlockIndex(const std::vector<std::string> &blockIds);
+
+// Block IDs of the part writers of a blob, ordered by part, then by index.
+// Each opening of a part is a new attempt, so that the blocks left by a
+// previous attempt at writing the same part are not committed with it.
+std::string MakePartBlockId(size_t nPart, uint64_t nAttempt,
+                            size_t nBlockIndex);
+// Block IDs of the uploads of local files, identified by their size and
+// modification time, so that the blocks staged by an interrupted upload of the
+// same file by blocks of the same size can be reused by the next one
+std::string MakeUploadBlockId(size_t nFileSize, uint64_t nModificationTime,
+                              size_t nBlockSize, size_t nBlockIndex);
+// Returns the block IDs made by MakePartBlockId in the order of the blob,
+// keeping the last attempt at each part and ignoring the other IDs
+std::vector<std::string>
+GetPartBlockIds(const std::vector<std::string> &blockIds);
+} // namespace az
@@ -0,0 +1,56 @@
+#include "checkpoint.hpp"
+#include "exception.hpp"
+#include <cstdio>
+
+using namespace std;
+
+namespace az {
+TransferCheckpoint::TransferCheckpoint(const string &sPath, const string &sKey,
+                                       bool bResume)
+    : sPath(sPath), bResumed(false) {
+  // The key is recorded on the first line and each completed range on its
+  // own line. Only lines ending with a newline were completely recorded.
+  if (bResume) {
+    ifstream ifs(sPath);
+    string sLine;
+    if (getline(ifs, sLine) && !ifs.eof() && sLine == sKey) {
+      bResumed = true;
+      while (getline(ifs, sLine) && !ifs.eof()) {
+        try {
+          doneOffsets.insert((size_t)stoull(sLine));
+        } catch (const exception &) {
+          // not a range offset
+        }
+      }
+    }
+  }
+
+  // The recorded ranges are written again, so that a range partially
+  // recorded before the interruption is not completed by the next ones
+  ofs.open(sPath, ios::trunc);
+  ofs << sKey << '\n';
+  for (size_t nOffset : doneOffsets)
+    ofs << nOffset << '\n';
+  ofs.flush();
+  if (!ofs)
+    throw LocalFileError(sPath);
+}
+
+bool TransferCheckpoint::IsResumed() const { return bResumed; }
+
+bool TransferCheckpoint::IsDone(size_t nOffset) const {
+  return doneOffsets.count(nOffset) > 0;
+}
+
+void TransferCheckpoint::MarkDone(size_t nOffset) {
+  lock_guard<std::mutex> lock(mutex);
+  ofs << nOffset << '\n';
+  ofs.flush();
+}
+
+void TransferCheckpoint::Remove() {
+  lock_guard<std::mutex> lock(mutex);
+  ofs.close();
+  remove(sPath.c_str());
+}
+} // namespace az
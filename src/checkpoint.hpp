@@ -0,0 +1,39 @@
+// Sidecar file recording the completed ranges of a transfer to a local file,
+// so that a transfer of the same source interrupted by a failure resumes where
+// it stopped instead of starting over.
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace az {
+class TransferCheckpoint {
+public:
+  // Resumes the checkpoint recorded in sPath if bResume is set and it was
+  // recorded for the same key, identifying the source and the ranges.
+  // Otherwise a new checkpoint with no completed range is recorded there.
+  TransferCheckpoint(const std::string &sPath, const std::string &sKey,
+                     bool bResume);
+
+  TransferCheckpoint(const TransferCheckpoint &) = delete;
+  TransferCheckpoint &operator=(const TransferCheckpoint &) = delete;
+
+  bool IsResumed() const;
+  bool IsDone(size_t nOffset) const;
+  // Records the range at nOffset as completed. Can be called concurrently.
+  void MarkDone(size_t nOffset);
+  // Removes the sidecar file, once the transfer is complete
+  void Remove();
+
+private:
+  std::string sPath;
+  bool bResumed;
+  std::set<size_t> doneOffsets;
+  std::mutex mutex;
+  std::ofstream ofs;
+};
+} // namespace az
@@ -0,0 +1,237 @@
+#include "clientpool.hpp"
+#include "authentication.hpp"
+#include "taskgroup.hpp"
+#include <azure/core/url.hpp>
+#include <azure/identity.hpp>
+#include <azure/storage/common/account_sas_builder.hpp>
+#include <azure/storage/files/shares/share_options.hpp>
+#include <chrono>
+#include <exception>
+#include <spdlog/spdlog.h>
+
+using namespace std;
+
+namespace az {
+using BlobServiceClient = Azure::Storage::Blobs::BlobServiceClient;
+using ShareServiceClient = Azure::Storage::Files::Shares::ShareServiceClient;
+using ShareClientOptions = Azure::Storage::Files::Shares::ShareClientOptions;
+
+// Time given to each warm-up request, so that unreachable endpoints are given
+// up on quickly
+static constexpr chrono::seconds warmupRequestTimeout(5);
+// Validity of the SAS tokens signed for the sources of copy requests
+static constexpr chrono::hours copySourceSasValidity(1);
+
+ClientPool::ClientPool(shared_ptr<const Config> config) : config(config) {
+  if (config->bEmulatedStorage) {
+    emulatedStorageCredential =
+        make_shared<Azure::Storage::StorageSharedKeyCredential>(
+            config->emulatedConnectionString.sAccountName,
+            config->emulatedConnectionString.sAccountKey);
+  }
+  if (!config->sStorageAccountKey.empty()) {
+    cloudSharedKeyCredential =
+        make_shared<Azure::Storage::StorageSharedKeyCredential>(
+            config->sStorageAccountName, config->sStorageAccountKey);
+  }
+  // The credential is shared by all the service clients, so that tokens are
+  // acquired once and then cached for the whole connection
+  cloudStorageCredential = make_shared<Azure::Identity::ChainedTokenCredential>(
+      Azure::Identity::ChainedTokenCredential::Sources{
+          // for Client ID + Client Secret or Certificate environment
+          // variables
+          make_shared<Azure::Identity::EnvironmentCredential>(),
+          make_shared<Azure::Identity::WorkloadIdentityCredential>(),
+          make_shared<Azure::Identity::ManagedIdentityCredential>(),
+          make_shared<Azure::Identity::AzureCliCredential>()});
+}
+
+ClientPool::~ClientPool() {
+  // The pending warm-up requests fail as soon as they are cancelled
+  warmupContext.Cancel();
+  if (warmupThread.joinable())
+    warmupThread.join();
+}
+
+BlobServiceClient ClientPool::GetBlobServiceClient(const string &sServiceUrl,
+                                                   bool bEmulated) {
+  lock_guard<std::mutex> lock(mutex);
+  auto it = blobServiceClients.find(sServiceUrl);
+  if (it == blobServiceClients.end()) {
+    Authentication authentication =
+        GetAuthentication(*config, sServiceUrl, bEmulated);
+    string sClientUrl =
+        GetServiceClientUrl(*config, sServiceUrl, authentication);
+    switch (authentication) {
+    case Authentication::EMULATOR_KEY:
+      it = blobServiceClients
+               .emplace(sServiceUrl, BlobServiceClient(
+                                         sClientUrl, emulatedStorageCredential))
+               .first;
+      break;
+    case Authentication::ACCOUNT_KEY:
+      it = blobServiceClients
+               .emplace(sServiceUrl, BlobServiceClient(
+                                         sClientUrl, cloudSharedKeyCredential))
+               .first;
+      break;
+    case Authentication::SAS_TOKEN:
+      it = blobServiceClients
+               .emplace(sServiceUrl, BlobServiceClient(sClientUrl))
+               .first;
+      break;
+    case Authentication::STORAGE_TOKEN:
+      it = blobServiceClients
+               .emplace(sServiceUrl,
+                        BlobServiceClient(sClientUrl, cloudStorageCredential))
+               .first;
+      break;
+    }
+  }
+  return it->second;
+}
+
+ShareServiceClient
+ClientPool::GetShareServiceClient(const string &sServiceUrl) {
+  lock_guard<std::mutex> lock(mutex);
+  auto it = shareServiceClients.find(sServiceUrl);
+  if (it == shareServiceClients.end()) {
+    // the emulator does not support shares
+    Authentication authentication =
+        GetAuthentication(*config, sServiceUrl, false);
+    string sClientUrl =
+        GetServiceClientUrl(*config, sServiceUrl, authentication);
+    if (authentication == Authentication::ACCOUNT_KEY) {
+      it = shareServiceClients
+               .emplace(sServiceUrl, ShareServiceClient(
+                                         sClientUrl, cloudSharedKeyCredential))
+               .first;
+    } else if (authentication == Authentication::SAS_TOKEN) {
+      it = shareServiceClients
+               .emplace(sServiceUrl, ShareServiceClient(sClientUrl))
+               .first;
+    } else {
+      // token authentication to file shares requires a token intent
+      ShareClientOptions opts;
+      opts.ShareTokenIntent =
+          Azure::Storage::Files::Shares::Models::ShareTokenIntent::Backup;
+      it = shareServiceClients
+               .emplace(sServiceUrl,
+                        ShareServiceClient(sClientUrl, cloudStorageCredential,
+                                           opts))
+               .first;
+    }
+  }
+  return it->second;
+}
+
+CopySourceAuthorization
+ClientPool::GetCopySourceAuthorization(const string &sServiceUrl,
+                                       bool bEmulated) const {
+  CopySourceAuthorization authorization;
+  // Shared keys only sign the requests themselves, so the service is given a
+  // SAS token signed with the key to read the sources
+  Authentication authentication =
+      GetAuthentication(*config, sServiceUrl, bEmulated);
+  shared_ptr<Azure::Storage::StorageSharedKeyCredential> sharedKeyCredential;
+  if (authentication == Authentication::EMULATOR_KEY)
+    sharedKeyCredential = emulatedStorageCredential;
+  else if (authentication == Authentication::ACCOUNT_KEY)
+    sharedKeyCredential = cloudSharedKeyCredential;
+  if (sharedKeyCredential) {
+    Azure::Storage::Sas::AccountSasBuilder sasBuilder;
+    sasBuilder.Protocol = bEmulated
+                              ? Azure::Storage::Sas::SasProtocol::HttpsAndHttp
+                              : Azure::Storage::Sas::SasProtocol::HttpsOnly;
+    sasBuilder.ExpiresOn = chrono::system_clock::now() + copySourceSasValidity;
+    sasBuilder.Services = Azure::Storage::Sas::AccountSasServices::Blobs |
+                          Azure::Storage::Sas::AccountSasServices::Files;
+    sasBuilder.ResourceTypes = Azure::Storage::Sas::AccountSasResource::Object;
+    sasBuilder.SetPermissions(Azure::Storage::Sas::AccountSasPermissions::Read);
+    authorization.sSasToken =
+        sasBuilder.GenerateSasToken(*sharedKeyCredential);
+    if (util::str::StartsWith(authorization.sSasToken, "?"))
+      authorization.sSasToken.erase(0, 1);
+    return authorization;
+  }
+  // SAS tokens of the configuration are part of the source URLs
+  if (authentication == Authentication::SAS_TOKEN)
+    return authorization;
+  try {
+    authorization.sAuthorization = "Bearer " + GetStorageToken();
+  } catch (const exception &e) {
+    spdlog::warn("Copy source token acquisition failed: {}", e.what());
+  }
+  return authorization;
+}
+
+string
+ClientPool::GetStorageToken(const Azure::Core::Context &context) const {
+  // The credential caches the token, so that it is only acquired again when
+  // about to expire
+  Azure::Core::Credentials::TokenRequestContext tokenRequestContext;
+  tokenRequestContext.Scopes = {"https://storage.azure.com/.default"};
+  return cloudStorageCredential->GetToken(tokenRequestContext, context).Token;
+}
+
+void ClientPool::StartWarmup() {
+  if (warmupThread.joinable())
+    warmupThread.join();
+  warmupThread = thread(&ClientPool::WarmUp, this);
+}
+
+void ClientPool::WarmUp() {
+  const auto &serviceUrls = config->warmupServiceUrls;
+  bool bEmulated = config->bEmulatedStorage;
+
+  bool bNeedsToken = false;
+  for (const auto &sServiceUrl : serviceUrls)
+    bNeedsToken = bNeedsToken ||
+                  GetAuthentication(*config, sServiceUrl, bEmulated) ==
+                      Authentication::STORAGE_TOKEN;
+  if (bNeedsToken) {
+    try {
+      GetStorageToken(warmupContext.WithDeadline(chrono::system_clock::now() +
+                                                 warmupRequestTimeout));
+    } catch (const exception &e) {
+      spdlog::debug("Warm-up token acquisition failed: {}", e.what());
+    }
+  }
+
+  // Concurrent requests force the transport to open as many connections,
+  // which are then kept alive in its pool. Their result does not matter: even
+  // an authorization error leaves a connected socket behind.
+  // All the requests are in flight at once, as the connections of a service
+  // URL are only opened by concurrent requests to it.
+  TaskGroup requests(config->nWarmupConnections * serviceUrls.size());
+  for (const auto &sServiceUrl : serviceUrls) {
+    for (size_t i = 0; i < config->nWarmupConnections; i++) {
+      requests.Submit([this, sServiceUrl, bEmulated]() {
+        auto context = warmupContext.WithDeadline(chrono::system_clock::now() +
+                                                  warmupRequestTimeout);
+        try {
+          // service URLs are classified as the URLs of the operations
+          StorageType storageType = BLOB;
+          if (!bEmulated && !util::url::GetStorageType(
+                                Azure::Core::Url(sServiceUrl).GetHost(),
+                                storageType))
+            throw InvalidDomainError(sServiceUrl);
+          if (storageType == SHARE)
+            GetShareServiceClient(sServiceUrl)
+                .GetProperties(Azure::Storage::Files::Shares::
+                                   GetServicePropertiesOptions(),
+                               context);
+          else
+            GetBlobServiceClient(sServiceUrl, bEmulated)
+                .GetAccountInfo(
+                    Azure::Storage::Blobs::GetAccountInfoOptions(), context);
+        } catch (const exception &e) {
+          spdlog::debug("Warm-up request to {} failed: {}", sServiceUrl,
+                        e.what());
+        }
+      });
+    }
+  }
+  requests.Wait();
+}
+} // namespace az
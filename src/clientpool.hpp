@@ -0,0 +1,81 @@
+// Registry of the storage service clients used by the driver. It is created
+// when the driver connects and keeps one service client per account, from
+// which all container, blob, share, directory and file clients are derived so
+// that they share the same HTTP pipeline, retry policy and connection pool.
+// Requests to cloud accounts are authenticated with the account key or the SAS
+// token of the configuration when there is one for the account, and with Azure
+// AD tokens otherwise.
+// The pool can also be warmed up in the background so that the first
+// operations do not pay for token acquisition, DNS and TLS handshakes. The
+// warm-up is cancelled when the pool is destroyed.
+
+#pragma once
+
+#include "config.hpp"
+#include "copysource.hpp"
+#include <azure/core/context.hpp>
+#include <azure/core/credentials/credentials.hpp>
+#include <azure/storage/blobs/blob_service_client.hpp>
+#include <azure/storage/common/storage_credential.hpp>
+#include <azure/storage/files/shares/share_service_client.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace az {
+class ClientPool {
+public:
+  explicit ClientPool(std::shared_ptr<const Config> config);
+  ~ClientPool();
+
+  ClientPool(const ClientPool &) = delete;
+  ClientPool &operator=(const ClientPool &) = delete;
+
+  Azure::Storage::Blobs::BlobServiceClient
+  GetBlobServiceClient(const std::string &sServiceUrl, bool bEmulated);
+  Azure::Storage::Files::Shares::ShareServiceClient
+  GetShareServiceClient(const std::string &sServiceUrl);
+
+  // Returns the authorization to give the service when it reads a source blob
+  // or file of the service URL on behalf of a copy request: a read-only SAS
+  // token signed with the account key for a while, or a storage token. It is
+  // empty if the source URLs carry their own SAS token, or if no token can be
+  // acquired.
+  CopySourceAuthorization
+  GetCopySourceAuthorization(const std::string &sServiceUrl,
+                             bool bEmulated) const;
+
+  // Starts warming up the service URLs of the configuration in the
+  // background: acquires a storage token if needed and opens the configured
+  // number of pooled connections to each of them, each request being given a
+  // few seconds. Failures are ignored, the operations will report them if
+  // they persist.
+  void StartWarmup();
+
+private:
+  std::string GetStorageToken(
+      const Azure::Core::Context &context = Azure::Core::Context()) const;
+  void WarmUp();
+
+  std::shared_ptr<const Config> config;
+  std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>
+      emulatedStorageCredential;
+  std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>
+      cloudSharedKeyCredential;
+  std::shared_ptr<Azure::Core::Credentials::TokenCredential>
+      cloudStorageCredential;
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Azure::Storage::Blobs::BlobServiceClient>
+      blobServiceClients;
+  std::unordered_map<std::string,
+                     Azure::Storage::Files::Shares::ShareServiceClient>
+      shareServiceClients;
+
+  Azure::Core::Context warmupContext;
+  std::thread warmupThread;
+};
+} // namespace az
@@ -0,0 +1,112 @@
+#include "config.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace az {
+static size_t GetSizeSetting(const string &sVarName, size_t nDefaultValue);
+
+Config::Config()
+    : bEmulatedStorage(false),
+      nPreferredBufferSize(nDefaultPreferredBufferSize),
+      nWriteBlockSize(nDefaultWriteBlockSize),
+      nWriteConcurrency(nDefaultWriteConcurrency),
+      flushPolicy(FlushPolicy::CHANGED), nMinFlushSize(0),
+      bAsyncClose(false), bAppendBlobs(false),
+      nCompactionBlockCount(nDefaultCompactionBlockCount),
+      nShardSize(nDefaultShardSize),
+      nTransferRangeSize(nDefaultTransferRangeSize),
+      nTransferConcurrency(nDefaultTransferConcurrency),
+      bResumableTransfers(false), bSyncTransfers(false),
+      nDeleteConcurrency(nDefaultDeleteConcurrency), bRecursiveDelete(false),
+      nParsedUrlCacheCapacity(nDefaultParsedUrlCacheCapacity),
+      nWarmupConnections(nDefaultWarmupConnections) {}
+
+Config Config::FromEnvironment() {
+  Config config;
+
+  config.bEmulatedStorage =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_EMULATED_STORAGE", "false")) != "false";
+  if (config.bEmulatedStorage) {
+    config.emulatedConnectionString =
+        util::connstr::ConnectionString::ParseConnectionString(
+            util::env::GetEnvironmentVariableOrThrow(
+                "AZURE_STORAGE_CONNECTION_STRING"));
+    config.sEmulatedBlobEndpoint =
+        config.emulatedConnectionString.blobEndpoint.GetAbsoluteUrl();
+  }
+
+  config.sStorageAccountName =
+      util::env::GetEnvironmentVariableOrDefault("AZURE_STORAGE_ACCOUNT", "");
+  config.sStorageAccountKey =
+      util::env::GetEnvironmentVariableOrDefault("AZURE_STORAGE_KEY", "");
+  config.sStorageSasToken =
+      util::env::GetEnvironmentVariableOrDefault("AZURE_STORAGE_SAS_TOKEN", "");
+  if (util::str::StartsWith(config.sStorageSasToken, "?"))
+    config.sStorageSasToken.erase(0, 1);
+  if (!config.sStorageAccountKey.empty() && config.sStorageAccountName.empty())
+    throw util::env::EnvironmentVariableNotFoundError("AZURE_STORAGE_ACCOUNT");
+
+  config.nPreferredBufferSize = GetSizeSetting("AZURE_PREFERRED_BUFFER_SIZE",
+                                               nDefaultPreferredBufferSize);
+  config.nWriteBlockSize =
+      GetSizeSetting("AZURE_WRITE_BLOCK_SIZE", nDefaultWriteBlockSize);
+  config.nWriteConcurrency =
+      GetSizeSetting("AZURE_WRITE_CONCURRENCY", nDefaultWriteConcurrency);
+  string sFlushPolicy = util::str::ToLower(
+      util::env::GetEnvironmentVariableOrDefault("AZURE_FLUSH_POLICY", ""));
+  if (sFlushPolicy == "always")
+    config.flushPolicy = FlushPolicy::ALWAYS;
+  else if (sFlushPolicy == "close")
+    config.flushPolicy = FlushPolicy::CLOSE;
+  config.nMinFlushSize = GetSizeSetting("AZURE_FLUSH_MIN_SIZE", 0);
+  config.bAsyncClose =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_ASYNC_CLOSE", "false")) != "false";
+  config.bAppendBlobs =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_APPEND_BLOBS", "false")) != "false";
+  config.nCompactionBlockCount = GetSizeSetting(
+      "AZURE_COMPACTION_BLOCK_COUNT", nDefaultCompactionBlockCount);
+  config.nShardSize = GetSizeSetting("AZURE_SHARD_SIZE", nDefaultShardSize);
+  config.nTransferRangeSize = max(
+      GetSizeSetting("AZURE_TRANSFER_RANGE_SIZE", nDefaultTransferRangeSize),
+      (size_t)1);
+  config.nTransferConcurrency = GetSizeSetting("AZURE_TRANSFER_CONCURRENCY",
+                                               nDefaultTransferConcurrency);
+  config.bResumableTransfers =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_RESUMABLE_TRANSFERS", "false")) != "false";
+  config.bSyncTransfers =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_SYNC_TRANSFERS", "false")) != "false";
+  config.nDeleteConcurrency =
+      GetSizeSetting("AZURE_DELETE_CONCURRENCY", nDefaultDeleteConcurrency);
+  config.bRecursiveDelete =
+      util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
+          "AZURE_RECURSIVE_DELETE", "false")) != "false";
+  config.nParsedUrlCacheCapacity =
+      GetSizeSetting("AZURE_URL_CACHE_SIZE", nDefaultParsedUrlCacheCapacity);
+
+  // comma-separated service URLs, eg.
+  // https://account.blob.core.windows.net,https://account.file.core.windows.net
+  config.warmupServiceUrls = util::str::Split(
+      util::env::GetEnvironmentVariableOrDefault("AZURE_WARMUP_ENDPOINTS", ""),
+      ',', -1, true);
+  config.nWarmupConnections = GetSizeSetting("AZURE_WARMUP_CONNECTIONS",
+                                             nDefaultWarmupConnections);
+
+  return config;
+}
+
+static size_t GetSizeSetting(const string &sVarName, size_t nDefaultValue) {
+  try {
+    return stoull(util::env::GetEnvironmentVariableOrThrow(sVarName));
+  } catch (const exception &) {
+    // if the env var is not set, is empty or contains non-numeric data,
+    // fallback to the default value
+    return nDefaultValue;
+  }
+}
+} // namespace az
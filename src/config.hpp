@@ -0,0 +1,72 @@
+// Driver settings. They are read from the environment once, when the driver
+// connects, into an immutable snapshot shared by all the operations.
+
+#pragma once
+
+#include "util.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace az {
+static constexpr size_t nDefaultPreferredBufferSize = 4 * 1024 * 1024;
+static constexpr size_t nDefaultParsedUrlCacheCapacity = 1024;
+static constexpr size_t nDefaultWarmupConnections = 4;
+static constexpr size_t nDefaultWriteBlockSize = 8 * 1024 * 1024;
+static constexpr size_t nDefaultWriteConcurrency = 4;
+static constexpr size_t nAsyncCloseConcurrency = 8;
+static constexpr size_t nDefaultCompactionBlockCount = 10000;
+static constexpr size_t nDefaultShardSize = 1024 * 1024 * 1024;
+static constexpr size_t nDefaultTransferRangeSize = 8 * 1024 * 1024;
+static constexpr size_t nDefaultTransferConcurrency = 8;
+static constexpr size_t nDefaultDeleteConcurrency = 8;
+
+// When fflush makes the data written to a blob durable by committing its block
+// list: on each call, only if data was written since the last commit, or only
+// when the file is closed
+enum class FlushPolicy { ALWAYS, CHANGED, CLOSE };
+
+struct Config {
+  bool bEmulatedStorage;
+  util::connstr::ConnectionString emulatedConnectionString;
+  std::string sEmulatedBlobEndpoint;
+  // Local signing of the requests to cloud accounts, instead of Azure AD
+  // tokens: an account key or a SAS token, used for the account named
+  // sStorageAccountName or for all accounts if it is empty
+  std::string sStorageAccountName;
+  std::string sStorageAccountKey;
+  std::string sStorageSasToken;
+  size_t nPreferredBufferSize;
+  size_t nWriteBlockSize; // initial size of the blocks staged by blob writers
+  size_t nWriteConcurrency; // max blocks being staged at once by a writer
+  FlushPolicy flushPolicy;
+  // bytes to write since the last commit to commit again. The blocks do not
+  // multiply with the commits, the partial block being staged again under the
+  // same ID until complete, but each commit is a request.
+  size_t nMinFlushSize;
+  bool bAsyncClose; // close files in the background until the next sync
+  bool bAppendBlobs; // append to append blobs rather than block blobs
+  // committed blocks from which appended blobs are compacted, 0 to never do it
+  size_t nCompactionBlockCount;
+  size_t nShardSize; // size from which the parts of sharded files are rotated
+  // Copies between the local file system and the storage are split into
+  // ranges transferred concurrently
+  size_t nTransferRangeSize;
+  size_t nTransferConcurrency;
+  // interrupted transfers resume from a checkpoint, rather than starting over
+  bool bResumableTransfers;
+  // copies skip the files whose destination already has the same content
+  bool bSyncTransfers;
+  size_t nDeleteConcurrency; // max deletion requests or batches at once
+  // share directories are removed with their content, by rmdir as well as by
+  // the removal of the directories matching a pattern
+  bool bRecursiveDelete;
+  size_t nParsedUrlCacheCapacity; // 0 disables the cache
+  std::vector<std::string> warmupServiceUrls; // empty disables the warm-up
+  size_t nWarmupConnections;                  // per service URL
+
+  Config();
+
+  static Config FromEnvironment();
+};
+} // namespace az
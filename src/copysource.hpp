@@ -0,0 +1,22 @@
+// Authorization of the storage services to read the source blobs or files of
+// copy requests on behalf of the driver: a bearer token sent along with the
+// request, or a SAS token appended to the source URLs. Neither is needed when
+// the source URLs already carry the SAS token of the configuration.
+
+#pragma once
+
+#include <string>
+
+namespace az {
+struct CopySourceAuthorization {
+  std::string sAuthorization; // value of the source authorization header
+  std::string sSasToken;      // without its leading '?'
+
+  inline std::string GetSourceUrl(const std::string &sUrl) const {
+    if (sSasToken.empty())
+      return sUrl;
+    return sUrl + (sUrl.find('?') == std::string::npos ? "?" : "&") +
+           sSasToken;
+  }
+};
+} // namespace az
@@ -1,75 +1,46 @@
 #include "driver.hpp"
 #include "blobpathresolve.hpp"
+#include "blockid.hpp"
+#include "checkpoint.hpp"
 #include "exception.hpp"
+#include "servicelimits.hpp"
 #include "sharepathresolve.hpp"
 #include "storagetype.hpp"
 #include "util.hpp"
 #include <algorithm>
 #include <azure/core.hpp>
-#include <azure/identity.hpp>
 #include <azure/storage/blobs/blob_options.hpp>
 #include <azure/storage/blobs/block_blob_client.hpp>
+#include <azure/storage/common/storage_exception.hpp>
 #include <azure/storage/files/shares/share_options.hpp>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iterator>
-#include <regex>
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <iostream>
+#include <sys/stat.h>
 
 using namespace std;
 
 namespace az {
-ServiceRequest::ServiceRequest(
-    const Azure::Core::Url azureUrl, StorageType storageType, bool bDir,
-    const BlobInfo &blob,
-    shared_ptr<Azure::Storage::StorageSharedKeyCredential>
-        emulatedStorageCredential)
-    : azureUrl(azureUrl), storageType(storageType), bEmulated(true),
+ServiceRequest::ServiceRequest(const Azure::Core::Url azureUrl,
+                               StorageType storageType, bool bEmulated,
+                               bool bDir, const BlobInfo &blob)
+    : azureUrl(azureUrl), storageType(storageType), bEmulated(bEmulated),
       bDir(bDir) {
   new (&this->blob) BlobInfo{blob.sAccountName, blob.sContainer, blob.sBlob};
-  new (&this->emulatedStorageCredential)
-      std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>(
-          emulatedStorageCredential);
 }
 
-ServiceRequest::ServiceRequest(
-    const Azure::Core::Url azureUrl, StorageType storageType, bool bDir,
-    const BlobInfo &blob,
-    shared_ptr<Azure::Core::Credentials::TokenCredential>
-        cloudStorageCredential)
-    : azureUrl(azureUrl), storageType(storageType), bEmulated(false),
-      bDir(bDir) {
-  new (&this->blob) BlobInfo{blob.sAccountName, blob.sContainer, blob.sBlob};
-  new (&this->cloudStorageCredential)
-      std::shared_ptr<Azure::Core::Credentials::TokenCredential>(
-          cloudStorageCredential);
-}
-
-ServiceRequest::ServiceRequest(
-    const Azure::Core::Url azureUrl, StorageType storageType, bool bDir,
-    const ShareInfo &share,
-    shared_ptr<Azure::Storage::StorageSharedKeyCredential>
-        emulatedStorageCredential)
-    : azureUrl(azureUrl), storageType(storageType), bEmulated(true),
-      bDir(bDir) {
-  new (&this->share) ShareInfo{share.sShare, share.path};
-  new (&this->emulatedStorageCredential)
-      std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>(
-          emulatedStorageCredential);
-}
-
-ServiceRequest::ServiceRequest(
-    const Azure::Core::Url azureUrl, StorageType storageType, bool bDir,
-    const ShareInfo &share,
-    shared_ptr<Azure::Core::Credentials::TokenCredential>
-        cloudStorageCredential)
-    : azureUrl(azureUrl), storageType(storageType), bEmulated(false),
+ServiceRequest::ServiceRequest(const Azure::Core::Url azureUrl,
+                               StorageType storageType, bool bEmulated,
+                               bool bDir, const ShareInfo &share)
+    : azureUrl(azureUrl), storageType(storageType), bEmulated(bEmulated),
       bDir(bDir) {
   new (&this->share) ShareInfo{share.sShare, share.path};
-  new (&this->cloudStorageCredential)
-      std::shared_ptr<Azure::Core::Credentials::TokenCredential>(
-          cloudStorageCredential);
 }
 
 ServiceRequest::ServiceRequest(const ServiceRequest &other)
@@ -80,15 +51,6 @@ ServiceRequest::ServiceRequest(const ServiceRequest &other)
   } else {
     new (&this->share) ShareInfo(other.share);
   }
-  if (bEmulated) {
-    new (&this->emulatedStorageCredential)
-        std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>(
-            other.emulatedStorageCredential);
-  } else {
-    new (&this->cloudStorageCredential)
-        std::shared_ptr<Azure::Core::Credentials::TokenCredential>(
-            other.cloudStorageCredential);
-  }
 }
 
 ServiceRequest::~ServiceRequest() {
@@ -96,24 +58,22 @@ ServiceRequest::~ServiceRequest() {
     blob.~BlobInfo();
   else
     share.~ShareInfo();
-  if (bEmulated)
-    emulatedStorageCredential.~shared_ptr();
-  else
-    cloudStorageCredential.~shared_ptr();
 }
 
 Driver::Driver() : bIsConnected(false) {
   try {
-    nPreferredBufferSize = stoull(util::env::GetEnvironmentVariableOrThrow(
-        "AZURE_PREFERRED_BUFFER_SIZE"));
+    config = make_shared<const Config>(Config::FromEnvironment());
   } catch (const exception &) {
-    // if the env var is not set, is empty or contains non-numeric data,
-    // fallback to the default preferred buffer size
-    nPreferredBufferSize = nDefaultPreferredBufferSize;
+    // The driver is constructed when the library is loaded, so errors are only
+    // reported when connecting
+    config = make_shared<const Config>();
   }
 }
 
-Driver::~Driver() { fileStreams.clear(); }
+Driver::~Driver() {
+  asyncCloses.reset();
+  fileStreams.clear();
+}
 
 const string &Driver::GetName() const { return sName; }
 
@@ -123,45 +83,74 @@ const string &Driver::GetScheme() const { return sScheme; }
 
 bool Driver::IsReadOnly() const { return false; }
 
-size_t Driver::GetPreferredBufferSize() const { return nPreferredBufferSize; }
+size_t Driver::GetPreferredBufferSize() const {
+  return config->nPreferredBufferSize;
+}
 
-void Driver::Connect() { bIsConnected = true; }
+void Driver::Connect() {
+  config = make_shared<const Config>(Config::FromEnvironment());
+
+  clientPool = make_unique<ClientPool>(config);
+  parsedUrlCache =
+      make_unique<ParsedUrlCache>(config->nParsedUrlCacheCapacity);
+  if (!config->warmupServiceUrls.empty()) {
+    clientPool->StartWarmup();
+  }
+  if (config->bAsyncClose)
+    asyncCloses = make_unique<TaskGroup>(nAsyncCloseConcurrency);
+  else
+    asyncCloses.reset();
+  bIsConnected = true;
+}
 
 void Driver::Disconnect() {
   CheckConnected();
+  // The files being closed are completed before disconnecting, and their
+  // errors reported once disconnected
+  exception_ptr syncError;
+  try {
+    Sync();
+  } catch (const exception &) {
+    syncError = current_exception();
+  }
+  asyncCloses.reset();
+  clientPool.reset();
+  parsedUrlCache.reset();
   bIsConnected = false;
+  if (syncError)
+    rethrow_exception(syncError);
 }
 
 bool Driver::IsConnected() const { return bIsConnected; }
 
 bool Driver::Exists(const string &sUrl) const {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       return true; // there is no such concept as a directory when dealing with
                    // blob services
     } else {
-      return !ListBlobs(request).empty();
+      return !ListBlobs(*request).empty();
     }
   } else // SHARE
   {
-    if (request.bDir) {
-      return !ListDirs(request).empty();
+    if (request->bDir) {
+      return !ListDirs(*request).empty();
     } else {
-      return !ListFiles(request).empty();
+      return !ListFiles(*request).empty();
     }
   }
 }
 
 size_t Driver::GetSize(const string &sUrl) const {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::GET_SIZE);
     } else {
-      auto blobs = ListBlobs(request);
+      auto blobs = ListBlobs(*request);
       if (blobs.empty()) {
         throw NoFileError(sUrl);
       }
@@ -169,10 +158,10 @@ size_t Driver::GetSize(const string &sUrl) const {
     }
   } else // SHARE
   {
-    if (request.bDir) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::GET_SIZE);
     } else {
-      auto files = ListFiles(request);
+      auto files = ListFiles(*request);
       if (files.empty()) {
         throw NoFileError(sUrl);
       }
@@ -183,12 +172,12 @@ size_t Driver::GetSize(const string &sUrl) const {
 
 FileStream &Driver::OpenForReading(const string &sUrl) {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::READ);
     } else {
-      auto blobs = ListBlobs(request);
+      auto blobs = ListBlobs(*request);
       if (blobs.empty()) {
         throw NoFileError(sUrl);
       }
@@ -196,10 +185,10 @@ FileStream &Driver::OpenForReading(const string &sUrl) {
     }
   } else // SHARE
   {
-    if (request.bDir) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::READ);
     } else {
-      auto files = ListFiles(request);
+      auto files = ListFiles(*request);
       if (files.empty()) {
         throw NoFileError(sUrl);
       }
@@ -208,49 +197,98 @@ FileStream &Driver::OpenForReading(const string &sUrl) {
   }
 }
 
+// Name of a part of a sharded file, whose number replaces the first wildcard
+// of its name pattern
+static string GetShardName(const string &sPattern, size_t nPart) {
+  ostringstream os;
+  os << setw(2) << setfill('0') << nPart;
+  string sName = sPattern;
+  return sName.replace(sName.find('*'), 1, os.str());
+}
+
 FileStream &Driver::OpenForWriting(const string &sUrl) {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::WRITE);
+    } else if (request->blob.sBlob.find('*') != string::npos) {
+      // The parts do not depend on the driver, so that the stream can still be
+      // closed asynchronously after disconnection
+      auto containerClient = GetBlobContainerClient(*request);
+      string sPattern = request->blob.sBlob;
+      auto partClients = [containerClient, sPattern](size_t nPart) {
+        return ObjectClient(
+            containerClient.GetBlobClient(GetShardName(sPattern, nPart)));
+      };
+      // Parts left by a previous, longer, file would otherwise be read along
+      // with the new ones
+      set<string> partUrls;
+      for (size_t nPart = 0; nPart < FileStream::nMaxShardCount; nPart++)
+        partUrls.insert(partClients(nPart).blob.GetUrl());
+      for (const auto &blob : ListBlobs(*request)) {
+        if (partUrls.count(blob.GetUrl()) > 0)
+          blob.Delete();
+      }
+      return RegisterFileStream(
+          FileStream::OpenForShardedWriting(partClients, config));
     } else {
       return RegisterFileStream(FileStream::OpenForWriting(
-          FileStream::OutputMode::WRITE, GetBlobClient(request)));
+          FileStream::OutputMode::WRITE, GetBlobClient(*request), config,
+          CopySourceAuthorization()));
     }
   } else // SHARE
   {
-    if (request.bDir) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::WRITE);
+    } else if (request->share.path.back().find('*') != string::npos) {
+      // like CheckParentDirExists, fails if the parent directory is missing
+      auto dirClient = GetParentDir(*request);
+      string sPattern = request->share.path.back();
+      auto partClients = [dirClient, sPattern](size_t nPart) {
+        return ObjectClient(
+            dirClient.GetFileClient(GetShardName(sPattern, nPart)));
+      };
+      set<string> partUrls;
+      for (size_t nPart = 0; nPart < FileStream::nMaxShardCount; nPart++)
+        partUrls.insert(partClients(nPart).shareFile.GetUrl());
+      for (const auto &file : ListFiles(*request)) {
+        if (partUrls.count(file.GetUrl()) > 0)
+          file.Delete();
+      }
+      return RegisterFileStream(
+          FileStream::OpenForShardedWriting(partClients, config));
     } else {
-      CheckParentDirExists(request);
+      CheckParentDirExists(*request);
       return RegisterFileStream(FileStream::OpenForWriting(
-          FileStream::OutputMode::WRITE, GetFileClient(request)));
+          FileStream::OutputMode::WRITE, GetFileClient(*request), config));
     }
   }
 }
 
 FileStream &Driver::OpenForAppending(const string &sUrl) {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::APPEND);
     } else {
       return RegisterFileStream(FileStream::OpenForWriting(
-          FileStream::OutputMode::APPEND, GetBlobClient(request)));
+          FileStream::OutputMode::APPEND, GetBlobClient(*request), config,
+          clientPool->GetCopySourceAuthorization(GetServiceUrl(*request),
+                                                 request->bEmulated)));
     }
   } else // SHARE
   {
-    if (request.bDir) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::APPEND);
     } else {
-      string sFilename = request.share.path.back();
+      string sFilename = request->share.path.back();
       Azure::Storage::Files::Shares::ListFilesAndDirectoriesOptions opts;
       opts.Prefix = sFilename;
       bool bAlreadyExisting = false;
       for (auto pagedResponse =
-               GetParentDir(request).ListFilesAndDirectories(opts);
+               GetParentDir(*request).ListFilesAndDirectories(opts);
            pagedResponse.HasPage(); pagedResponse.MoveToNextPage()) {
         if (find_if(pagedResponse.Files.begin(), pagedResponse.Files.end(),
                     [sFilename](const auto &fileItem) {
@@ -260,20 +298,37 @@ FileStream &Driver::OpenForAppending(const string &sUrl) {
           break;
         }
       }
-      auto client = GetFileClient(request);
+      auto client = GetFileClient(*request);
       if (!bAlreadyExisting) {
         client.Create(0);
       }
-      return RegisterFileStream(
-          FileStream::OpenForWriting(FileStream::OutputMode::APPEND, client));
+      return RegisterFileStream(FileStream::OpenForWriting(
+          FileStream::OutputMode::APPEND, client, config));
     }
   }
 }
 
 void Driver::Close(void *handle) {
   FileStream &fileStream = RetrieveFileStream(handle);
-  fileStream.Close();
-  fileStreams.erase(fileStream.GetHandle());
+  if (!asyncCloses) {
+    fileStream.Close();
+    fileStreams.erase(fileStream.GetHandle());
+    return;
+  }
+
+  // The handle becomes invalid right away, the stream being owned by the
+  // closing task (shared since std::function requires copyable tasks)
+  auto it = fileStreams.find(fileStream.GetHandle());
+  shared_ptr<FileStream> closedStream(std::move(it->second));
+  fileStreams.erase(it);
+  asyncCloses->Submit([this, closedStream]() {
+    try {
+      closedStream->Close();
+    } catch (const exception &exc) {
+      lock_guard<mutex> lock(asyncCloseErrorsMutex);
+      asyncCloseErrors.push_back(exc.what());
+    }
+  });
 }
 
 size_t Driver::Read(void *handle, void *dest, size_t nSize, size_t nCount) {
@@ -293,58 +348,229 @@ void Driver::Flush(void *handle) { RetrieveFileStream(handle).Flush(); }
 
 void Driver::Remove(const string &sUrl) const {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::REMOVE);
     } else {
-      auto blobs = ListBlobs(request);
+      auto blobs = ListBlobs(*request);
       if (blobs.empty()) {
         throw NoFileError(sUrl);
       }
-      Azure::Storage::Blobs::DeleteBlobOptions opts;
-      opts.DeleteSnapshots = Azure::Storage::Blobs::Models::
-          DeleteSnapshotsOption::IncludeSnapshots;
-      for (const auto &blob : blobs) {
-        const string sBlobUrl = blob.GetUrl();
-        if (!blob.Delete(opts).Value.Deleted) {
-          throw DeletionError(sBlobUrl);
-        }
-      }
+      DeleteBlobs(*request, blobs);
     }
   } else // SHARE
   {
-    if (request.bDir) {
+    if (request->bDir) {
       throw InvalidOperationForDirError(DirOperation::REMOVE);
     } else {
-      auto files = ListFiles(request);
-      if (files.empty()) {
+      auto files = ListFiles(*request);
+      vector<Azure::Storage::Files::Shares::ShareDirectoryClient> dirs;
+      if (config->bRecursiveDelete) {
+        dirs = ListDirs(*request);
+      }
+      if (files.empty() && dirs.empty()) {
         throw NoFileError(sUrl);
       }
-      for (const auto &file : files) {
-        const string sFileUrl = file.GetUrl();
-        if (!file.Delete().Value.Deleted) {
-          throw DeletionError(sFileUrl);
+      DeleteShareFiles(files);
+      for (const auto &dir : dirs) {
+        DeleteShareDirRecursively(dir);
+      }
+    }
+  }
+}
+
+// Failures of concurrent deletions, reported together once all of them were
+// attempted
+class DeletionFailures {
+public:
+  DeletionFailures() : nCount(0) {}
+
+  void Record(const string &sError) {
+    lock_guard<mutex> lock(failuresMutex);
+    if (nCount++ == 0)
+      sFirstError = sError;
+  }
+
+  void ThrowIfAny() const {
+    if (nCount > 0)
+      throw DeletionsError(nCount, sFirstError);
+  }
+
+private:
+  mutex failuresMutex;
+  size_t nCount;
+  string sFirstError;
+};
+
+// Whether a batch request failed because the service does not support
+// batches, eg. emulators, rather than because of its content or of the
+// account's state
+static bool
+IsBatchUnavailableError(const Azure::Storage::StorageException &exc) {
+  using Azure::Core::Http::HttpStatusCode;
+  static const set<string> unavailableErrorCodes = {
+      "FeatureNotSupported", "NotImplemented", "UnsupportedHttpVerb",
+      "InvalidUri"};
+  return (exc.StatusCode == HttpStatusCode::BadRequest ||
+          exc.StatusCode == HttpStatusCode::NotFound ||
+          exc.StatusCode == HttpStatusCode::MethodNotAllowed ||
+          exc.StatusCode == HttpStatusCode::NotImplemented) &&
+         unavailableErrorCodes.count(exc.ErrorCode) > 0;
+}
+
+void Driver::DeleteBlobs(
+    const ServiceRequest &request,
+    const vector<Azure::Storage::Blobs::BlobClient> &blobs) const {
+  Azure::Storage::Blobs::DeleteBlobOptions opts;
+  opts.DeleteSnapshots = Azure::Storage::Blobs::Models::DeleteSnapshotsOption::
+      IncludeSnapshots;
+  auto containerClient = GetBlobContainerClient(request);
+  DeletionFailures failures;
+  auto deleteBlob = [&opts, &failures](
+                        const Azure::Storage::Blobs::BlobClient &blob) {
+    try {
+      if (!blob.Delete(opts).Value.Deleted)
+        failures.Record(DeletionError(blob.GetUrl()).what());
+    } catch (const exception &exc) {
+      failures.Record(exc.what());
+    }
+  };
+  // Returns false if batches are not available, its blobs being left to
+  // delete one by one. Other rejections of the batch as a whole, such as
+  // denied permissions or throttling, are errors.
+  auto deleteBatch = [&](size_t nFirst) {
+    size_t nEnd = min(nFirst + nMaxBatchSize, blobs.size());
+    auto batch = containerClient.CreateBatch();
+    vector<Azure::Storage::DeferredResponse<
+        Azure::Storage::Blobs::Models::DeleteBlobResult>>
+        results;
+    for (size_t i = nFirst; i < nEnd; i++)
+      results.push_back(batch.DeleteBlobUrl(blobs[i].GetUrl(), opts));
+    try {
+      containerClient.SubmitBatch(batch);
+    } catch (const Azure::Storage::StorageException &exc) {
+      if (!IsBatchUnavailableError(exc))
+        throw;
+      return false;
+    }
+    for (size_t i = nFirst; i < nEnd; i++) {
+      try {
+        if (!results[i - nFirst].GetResponse().Value.Deleted)
+          failures.Record(DeletionError(blobs[i].GetUrl()).what());
+      } catch (const exception &exc) {
+        failures.Record(exc.what());
+      }
+    }
+    return true;
+  };
+
+  // The first batch tells whether the service supports them, eg. emulators
+  // or SAS tokens may not
+  TaskGroup deletions(config->nDeleteConcurrency);
+  if (blobs.size() > 1 && deleteBatch(0)) {
+    for (size_t nFirst = nMaxBatchSize; nFirst < blobs.size();
+         nFirst += nMaxBatchSize) {
+      deletions.Submit([&, nFirst]() {
+        if (!deleteBatch(nFirst)) {
+          size_t nEnd = min(nFirst + nMaxBatchSize, blobs.size());
+          for (size_t i = nFirst; i < nEnd; i++)
+            deleteBlob(blobs[i]);
         }
+      });
+    }
+  } else {
+    for (const auto &blob : blobs)
+      deletions.Submit([&deleteBlob, blob]() { deleteBlob(blob); });
+  }
+  deletions.Wait();
+  failures.ThrowIfAny();
+}
+
+void Driver::DeleteShareFiles(
+    const vector<Azure::Storage::Files::Shares::ShareFileClient> &files) const {
+  DeletionFailures failures;
+  TaskGroup deletions(config->nDeleteConcurrency);
+  for (const auto &file : files) {
+    deletions.Submit([&failures, file]() {
+      try {
+        if (!file.Delete().Value.Deleted)
+          failures.Record(DeletionError(file.GetUrl()).what());
+      } catch (const exception &exc) {
+        failures.Record(exc.what());
       }
+    });
+  }
+  deletions.Wait();
+  failures.ThrowIfAny();
+}
+
+void Driver::DeleteShareDirRecursively(
+    const Azure::Storage::Files::Shares::ShareDirectoryClient &dir) const {
+  vector<vector<Azure::Storage::Files::Shares::ShareDirectoryClient>> levels{
+      {dir}};
+  while (!levels.back().empty()) {
+    vector<Azure::Storage::Files::Shares::ShareFileClient> files;
+    vector<Azure::Storage::Files::Shares::ShareDirectoryClient> subdirs;
+    mutex listingMutex;
+    // Declared after what the listings write to, so that it waits for them
+    // before they are destroyed if a listing fails
+    TaskGroup listings(config->nDeleteConcurrency);
+    for (const auto &levelDir : levels.back()) {
+      listings.Submit([&files, &subdirs, &listingMutex, levelDir]() {
+        vector<Azure::Storage::Files::Shares::ShareFileClient> dirFiles;
+        vector<Azure::Storage::Files::Shares::ShareDirectoryClient> dirSubdirs;
+        for (auto pagedResponse = levelDir.ListFilesAndDirectories();
+             pagedResponse.HasPage(); pagedResponse.MoveToNextPage()) {
+          for (const auto &fileItem : pagedResponse.Files)
+            dirFiles.push_back(levelDir.GetFileClient(fileItem.Name));
+          for (const auto &dirItem : pagedResponse.Directories)
+            dirSubdirs.push_back(levelDir.GetSubdirectoryClient(dirItem.Name));
+        }
+        lock_guard<mutex> lock(listingMutex);
+        files.insert(files.end(), dirFiles.begin(), dirFiles.end());
+        subdirs.insert(subdirs.end(), dirSubdirs.begin(), dirSubdirs.end());
+      });
     }
+    listings.Wait();
+    DeleteShareFiles(files);
+    levels.push_back(std::move(subdirs));
+  }
+
+  // The directories of a level are empty once those of the next one are
+  // deleted
+  DeletionFailures failures;
+  TaskGroup deletions(config->nDeleteConcurrency);
+  for (auto itLevel = levels.rbegin(); itLevel != levels.rend(); ++itLevel) {
+    for (const auto &levelDir : *itLevel) {
+      deletions.Submit([&failures, levelDir]() {
+        try {
+          if (!levelDir.Delete().Value.Deleted)
+            failures.Record(DeletionError(levelDir.GetUrl()).what());
+        } catch (const exception &exc) {
+          failures.Record(exc.what());
+        }
+      });
+    }
+    deletions.Wait();
+    failures.ThrowIfAny();
   }
 }
 
 void Driver::MkDir(const string &sUrl) const {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       // Do nothing
     } else {
       throw InvalidOperationForFileError(FileOperation::MKDIR);
     }
   } else // SHARE
   {
-    if (request.bDir) {
-      string sNewDir = request.share.path.back();
-      auto parentDirClient = GetParentDir(request);
+    if (request->bDir) {
+      string sNewDir = request->share.path.back();
+      auto parentDirClient = GetParentDir(*request);
 
       Azure::Storage::Files::Shares::ListFilesAndDirectoriesOptions opts;
       opts.Prefix = sNewDir;
@@ -372,21 +598,25 @@ void Driver::MkDir(const string &sUrl) const {
 
 void Driver::RmDir(const string &sUrl) const {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
+  auto request = ParseUrl(sUrl);
+  if (request->storageType == BLOB) {
+    if (request->bDir) {
       // Do nothing
     } else {
       throw InvalidOperationForFileError(FileOperation::RMDIR);
     }
   } else // SHARE
   {
-    if (request.bDir) {
-      auto dirs = ListDirs(request);
+    if (request->bDir) {
+      auto dirs = ListDirs(*request);
       if (dirs.empty()) {
         throw NoFileError(sUrl);
       }
       for (const auto &dir : dirs) {
+        if (config->bRecursiveDelete) {
+          DeleteShareDirRecursively(dir);
+          continue;
+        }
         const string sDirUrl = dir.GetUrl();
         if (!dir.Delete().Value.Deleted) {
           throw DeletionError(sDirUrl);
@@ -405,135 +635,432 @@ size_t Driver::GetFreeDiskSpace() const {
 
 void Driver::CopyTo(const string &sUrl, const std::string &destUrl) {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
-      throw InvalidOperationForDirError(DirOperation::COPY);
-    } else {
-      auto &reader = OpenForReading(sUrl);
-      char *buffer = new char[GetPreferredBufferSize()];
-      size_t nRead;
-      ofstream ofs(destUrl, ios::binary);
+  auto request = ParseUrl(sUrl);
+  if (request->bDir)
+    throw InvalidOperationForDirError(DirOperation::COPY);
 
-      for (;;) {
-        try {
-          nRead = reader.Read(buffer, 1, GetPreferredBufferSize());
-        } catch (const ReadAtEOFError &) {
-          break;
-        }
-        ofs.write(buffer, (streamsize)nRead);
-      }
+  auto &reader = OpenForReading(sUrl);
+  try {
+    DownloadRanges(reader, destUrl, config->nTransferConcurrency);
+  } catch (const exception &) {
+    Close(reader.GetHandle());
+    throw;
+  }
+  Close(reader.GetHandle());
+}
+
+// Size of a local file, which must exist
+static size_t GetLocalFileSize(const string &sPath) {
+  ifstream ifs(sPath, ios::binary | ios::ate);
+  if (!ifs)
+    throw LocalFileError(sPath);
+  return (size_t)ifs.tellg();
+}
+
+// Local files downloaded by sync transfers are recorded in a manifest next to
+// them, as the version of the file they were downloaded from followed by
+// their own modification time and size
+static string GetSyncManifestLine(const string &sPath,
+                                  const string &sVersion) {
+  struct stat localStat;
+  if (stat(sPath.c_str(), &localStat) != 0)
+    return "";
+  ostringstream line;
+  line << sVersion << ";" << util::localfs::GetModificationTime(sPath) << ";"
+       << localStat.st_size;
+  return line.str();
+}
+
+static bool IsLocalFileSynced(const string &sPath, const string &sVersion) {
+  string sLine = GetSyncManifestLine(sPath, sVersion);
+  string sRecordedLine;
+  ifstream ifs(sPath + ".sync");
+  return !sLine.empty() && getline(ifs, sRecordedLine) &&
+         sRecordedLine == sLine;
+}
 
-      delete[] buffer;
-      Close(reader.GetHandle());
+static void RecordLocalFileSync(const string &sPath, const string &sVersion) {
+  ofstream ofs(sPath + ".sync", ios::trunc);
+  ofs << GetSyncManifestLine(sPath, sVersion) << "\n";
+  if (!ofs)
+    throw LocalFileError(sPath + ".sync");
+}
+
+// Local files without the sync manifests and checkpoints kept next to the
+// downloaded files, which are not part of the data. These sidecars are only
+// recognized next to the file they are named after.
+static vector<string> RemoveTransferSidecars(const vector<string> &relPaths) {
+  set<string> relPathSet(relPaths.begin(), relPaths.end());
+  vector<string> dataRelPaths;
+  for (const auto &sRelPath : relPaths) {
+    bool bSidecar = false;
+    for (const string sSuffix : {".sync", ".checkpoint"}) {
+      if (util::str::EndsWith(sRelPath, sSuffix) &&
+          relPathSet.count(
+              sRelPath.substr(0, sRelPath.size() - sSuffix.size())) > 0)
+        bSidecar = true;
     }
-  } else // SHARE
-  {
-    if (request.bDir) {
-      throw InvalidOperationForDirError(DirOperation::COPY);
-    } else {
-      auto &reader = OpenForReading(sUrl);
-      char *buffer = new char[GetPreferredBufferSize()];
-      size_t nRead;
-      ofstream ofs(destUrl, ios::binary);
+    if (!bSidecar)
+      dataRelPaths.push_back(sRelPath);
+  }
+  return dataRelPaths;
+}
 
-      for (;;) {
-        try {
-          nRead = reader.Read(buffer, 1, GetPreferredBufferSize());
-        } catch (const ReadAtEOFError &) {
-          break;
-        }
-        ofs.write(buffer, (streamsize)nRead);
-      }
+// MD5 of the content of a local file, as stored by the services
+static vector<uint8_t> GetLocalFileMd5(const string &sPath) {
+  ifstream ifs(sPath, ios::binary);
+  if (!ifs)
+    throw LocalFileError(sPath);
+  Azure::Core::Cryptography::Md5Hash hash;
+  vector<char> buffer(nDefaultPreferredBufferSize);
+  while (ifs) {
+    ifs.read(buffer.data(), (streamsize)buffer.size());
+    hash.Append((const uint8_t *)buffer.data(), (size_t)ifs.gcount());
+  }
+  if (ifs.bad())
+    throw LocalFileError(sPath);
+  return hash.Final();
+}
+
+void Driver::DownloadRanges(const FileStream &reader, const string &sDestPath,
+                            size_t nConcurrency) const {
+  size_t nSize = reader.GetSize();
+  string sSyncVersion;
+  if (config->bSyncTransfers) {
+    ostringstream version;
+    version << reader.GetVersion() << ";" << nSize;
+    sSyncVersion = version.str();
+    if (IsLocalFileSynced(sDestPath, sSyncVersion))
+      return;
+  }
+  size_t nRangeSize = config->nTransferRangeSize;
+  unique_ptr<TransferCheckpoint> checkpoint;
+  if (config->bResumableTransfers) {
+    // The ranges downloaded before are only kept if the local file was
+    // already created for the same version of the file
+    bool bResume;
+    try {
+      bResume = GetLocalFileSize(sDestPath) == nSize;
+    } catch (const LocalFileError &) {
+      bResume = false;
+    }
+    ostringstream key;
+    key << reader.GetVersion() << ";" << nSize << "," << nRangeSize;
+    checkpoint = make_unique<TransferCheckpoint>(sDestPath + ".checkpoint",
+                                                 key.str(), bResume);
+  }
 
-      delete[] buffer;
-      Close(reader.GetHandle());
+  // The local file is created at its final size, so that each range can be
+  // written at its offset as soon as it is downloaded
+  if (!checkpoint || !checkpoint->IsResumed()) {
+    ofstream ofs(sDestPath, ios::binary | ios::trunc);
+    if (nSize > 0) {
+      ofs.seekp((streamoff)(nSize - 1));
+      ofs.put('\0');
     }
+    if (!ofs)
+      throw LocalFileError(sDestPath);
   }
+
+  util::localfs::PositionalFile destFile(sDestPath);
+  TaskGroup downloads(nConcurrency);
+  TransferCheckpoint *pCheckpoint = checkpoint.get();
+  for (size_t nOffset = 0; nOffset < nSize; nOffset += nRangeSize) {
+    if (pCheckpoint && pCheckpoint->IsDone(nOffset))
+      continue;
+    size_t nLength = min(nRangeSize, nSize - nOffset);
+    downloads.Submit([&reader, &destFile, pCheckpoint, nOffset, nLength]() {
+      vector<char> range(nLength);
+      reader.ReadAt(nOffset, range.data(), nLength);
+      destFile.WriteAt(nOffset, range.data(), nLength);
+      if (pCheckpoint)
+        pCheckpoint->MarkDone(nOffset);
+    });
+  }
+  downloads.Wait();
+  if (checkpoint)
+    checkpoint->Remove();
+  if (!sSyncVersion.empty())
+    RecordLocalFileSync(sDestPath, sSyncVersion);
 }
 
 void Driver::CopyFrom(const string &sUrl, const std::string &sourceUrl) {
   CheckConnected();
-  ServiceRequest request = ParseUrl(sUrl);
-  if (request.storageType == BLOB) {
-    if (request.bDir) {
-      throw InvalidOperationForDirError(DirOperation::COPY);
-    } else {
-      auto &writer = OpenForWriting(sUrl);
-      char *buffer = new char[GetPreferredBufferSize()];
-      size_t nRead;
-      ifstream ifs(sourceUrl, ios::binary);
-
-      for (;;) {
-        ifs.read(buffer, GetPreferredBufferSize());
-        nRead = (size_t)ifs.gcount();
-        if (nRead == 0) {
-          break;
-        }
-        writer.Write(buffer, 1, nRead);
+  auto request = ParseUrl(sUrl);
+  if (request->bDir)
+    throw InvalidOperationForDirError(DirOperation::COPY);
+  UploadFile(*request, sourceUrl, config->nTransferConcurrency);
+}
+
+void Driver::UploadFile(const ServiceRequest &request, const string &sourceUrl,
+                        size_t nTransferConcurrency) const {
+  size_t nSize = GetLocalFileSize(sourceUrl);
+  // Sync transfers skip the upload if the destination has the same size and
+  // MD5 as the local file, the MD5 being stored with each uploaded file. It is
+  // only computed when the sizes match, or for the upload.
+  Azure::Storage::ContentHash contentHash;
+  if (config->bSyncTransfers) {
+    contentHash.Algorithm = Azure::Storage::HashAlgorithm::Md5;
+    try {
+      size_t nRemoteSize;
+      vector<uint8_t> remoteMd5;
+      if (request.storageType == BLOB) {
+        auto properties = GetBlobClient(request).GetProperties().Value;
+        nRemoteSize = (size_t)properties.BlobSize;
+        remoteMd5 = properties.HttpHeaders.ContentHash.Value;
+      } else // SHARE
+      {
+        auto properties = GetFileClient(request).GetProperties().Value;
+        nRemoteSize = (size_t)properties.FileSize;
+        remoteMd5 = properties.HttpHeaders.ContentHash.Value;
+      }
+      if (nRemoteSize == nSize && !remoteMd5.empty()) {
+        contentHash.Value = GetLocalFileMd5(sourceUrl);
+        if (contentHash.Value == remoteMd5)
+          return;
       }
+    } catch (const Azure::Storage::StorageException &exc) {
+      if (exc.StatusCode != Azure::Core::Http::HttpStatusCode::NotFound)
+        throw;
+    }
+    if (contentHash.Value.empty())
+      contentHash.Value = GetLocalFileMd5(sourceUrl);
+  }
 
-      delete[] buffer;
-      Close(writer.GetHandle());
+  // The ranges of the file are uploaded concurrently by the SDK, each of them
+  // being read from the file at its offset straight into the request body
+  int32_t nConcurrency = (int32_t)max(nTransferConcurrency, (size_t)1);
+  if (request.storageType == BLOB) {
+    size_t nBlockSize =
+        min(max(config->nTransferRangeSize,
+                (nSize + nMaxBlockCount - 1) / nMaxBlockCount),
+            nMaxBlockSize);
+    Azure::Storage::Blobs::UploadBlockBlobFromOptions opts;
+    opts.HttpHeaders.ContentHash = contentHash;
+    if (config->bResumableTransfers) {
+      UploadBlocks(sourceUrl, nSize, nBlockSize,
+                   GetBlobClient(request).AsBlockBlobClient(),
+                   opts.HttpHeaders, nTransferConcurrency);
+      return;
     }
+    opts.TransferOptions.SingleUploadThreshold = (int64_t)nBlockSize;
+    opts.TransferOptions.ChunkSize = (int64_t)nBlockSize;
+    opts.TransferOptions.Concurrency = nConcurrency;
+    GetBlobClient(request).AsBlockBlobClient().UploadFrom(sourceUrl, opts);
   } else // SHARE
   {
-    if (request.bDir) {
-      throw InvalidOperationForDirError(DirOperation::COPY);
-    } else {
-      auto &writer = OpenForWriting(sUrl);
-      char *buffer = new char[GetPreferredBufferSize()];
-      size_t nRead;
-      ifstream ifs(sourceUrl, ios::binary);
-
-      for (;;) {
-        ifs.read(buffer, GetPreferredBufferSize());
-        nRead = (size_t)ifs.gcount();
-        if (nRead == 0) {
-          break;
-        }
-        writer.Write(buffer, 1, nRead);
-      }
+    CheckParentDirExists(request);
+    size_t nRangeSize = min(config->nTransferRangeSize, nMaxRangeSize);
+    Azure::Storage::Files::Shares::UploadFileFromOptions opts;
+    opts.HttpHeaders.ContentHash = contentHash;
+    opts.TransferOptions.SingleUploadThreshold = (int64_t)nRangeSize;
+    opts.TransferOptions.ChunkSize = (int64_t)nRangeSize;
+    opts.TransferOptions.Concurrency = nConcurrency;
+    GetFileClient(request).UploadFrom(sourceUrl, opts);
+  }
+}
+
+void Driver::UploadBlocks(
+    const string &sSourcePath, size_t nSize, size_t nBlockSize,
+    const Azure::Storage::Blobs::BlockBlobClient &client,
+    const Azure::Storage::Blobs::Models::BlobHttpHeaders &httpHeaders,
+    size_t nConcurrency) const {
+  uint64_t nModificationTime =
+      util::localfs::GetModificationTime(sSourcePath);
+
+  // The blocks left uncommitted by a previous upload of the same file are
+  // its checkpoint
+  map<string, size_t> stagedBlockSizes;
+  try {
+    Azure::Storage::Blobs::GetBlockListOptions opts;
+    opts.ListType =
+        Azure::Storage::Blobs::Models::BlockListType::Uncommitted;
+    for (const auto &block : client.GetBlockList(opts).Value.UncommittedBlocks)
+      stagedBlockSizes[block.Name] = (size_t)block.Size;
+  } catch (const Azure::Storage::StorageException &exc) {
+    if (exc.StatusCode != Azure::Core::Http::HttpStatusCode::NotFound)
+      throw;
+  }
+
+  vector<string> blockIds;
+  TaskGroup uploads(nConcurrency);
+  for (size_t nOffset = 0; nOffset < nSize; nOffset += nBlockSize) {
+    size_t nLength = min(nBlockSize, nSize - nOffset);
+    string sBlockId = MakeUploadBlockId(nSize, nModificationTime, nBlockSize,
+                                        blockIds.size());
+    blockIds.push_back(sBlockId);
+    auto it = stagedBlockSizes.find(sBlockId);
+    if (it != stagedBlockSizes.end() && it->second == nLength)
+      continue;
+    uploads.Submit([&sSourcePath, client, sBlockId, nOffset, nLength]() {
+      vector<uint8_t> block(nLength);
+      ifstream ifs(sSourcePath, ios::binary);
+      ifs.seekg((streamoff)nOffset);
+      ifs.read((char *)block.data(), (streamsize)nLength);
+      if (!ifs)
+        throw LocalFileError(sSourcePath);
+      Azure::Core::IO::MemoryBodyStream bodyStream(block.data(), nLength);
+      client.StageBlock(sBlockId, bodyStream);
+    });
+  }
+  uploads.Wait();
+  Azure::Storage::Blobs::CommitBlockListOptions opts;
+  opts.HttpHeaders = httpHeaders;
+  client.CommitBlockList(blockIds, opts);
+}
+
+// Directory of a path pattern, up to the slash preceding its first globbing
+// character
+static string GetPatternDir(const string &sPattern) {
+  size_t nSlashPos =
+      sPattern.rfind('/', util::glob::FindGlobbingChar(sPattern));
+  return nSlashPos == string::npos ? "" : sPattern.substr(0, nSlashPos + 1);
+}
+
+// Concurrency of the range transfers of each file of a bulk copy, for the
+// files transferred at once to share the transfer concurrency. A single large
+// file still gets all of it.
+static size_t GetFileTransferConcurrency(size_t nTransferConcurrency,
+                                         size_t nFilesInFlight) {
+  return max(nTransferConcurrency / max(nFilesInFlight, (size_t)1), (size_t)1);
+}
+
+void Driver::CopyAllTo(const string &sPatternUrl, const string &sDestDir) {
+  CheckConnected();
+  auto request = ParseUrl(sPatternUrl);
+  if (request->bDir)
+    throw InvalidOperationForDirError(DirOperation::COPY);
+
+  // The objects are copied at their path relative to the directory of the
+  // pattern, which follows their container or share in their URL path
+  vector<ObjectClient> clients;
+  string sPatternDir;
+  if (request->storageType == BLOB) {
+    auto blobs = ListBlobs(*request);
+    clients.assign(blobs.begin(), blobs.end());
+    sPatternDir =
+        request->blob.sContainer + "/" + GetPatternDir(request->blob.sBlob);
+  } else // SHARE
+  {
+    auto files = ListFiles(*request);
+    clients.assign(files.begin(), files.end());
+    string sPattern;
+    for (const auto &sSegment : request->share.path)
+      sPattern += (sPattern.empty() ? "" : "/") + sSegment;
+    sPatternDir = request->share.sShare + "/" + GetPatternDir(sPattern);
+  }
+  if (clients.empty())
+    throw NoFileError(sPatternUrl);
+
+  size_t nFilesInFlight = min(clients.size(), config->nTransferConcurrency);
+  size_t nFileConcurrency =
+      GetFileTransferConcurrency(config->nTransferConcurrency, nFilesInFlight);
+  // The object names are checked before anything is written, so that a name
+  // which would escape the destination directory fails the whole copy
+  vector<string> destPaths;
+  for (const auto &client : clients) {
+    string sPath = Azure::Core::Url::Decode(
+        Azure::Core::Url(client.GetUrl()).GetPath());
+    if (request->bEmulated)
+      sPath = sPath.substr(sPath.find('/') + 1); // account name
+    string sRelPath = util::str::StartsWith(sPath, sPatternDir)
+                          ? sPath.substr(sPatternDir.size())
+                          : sPath.substr(sPath.rfind('/') + 1);
+    if (!util::path::IsSafeRelativePath(sRelPath))
+      throw UnsafeRelativePathError(client.GetUrl());
+    destPaths.push_back(sDestDir + "/" + sRelPath);
+  }
 
-      delete[] buffer;
-      Close(writer.GetHandle());
+  TaskGroup downloads(nFilesInFlight);
+  for (size_t i = 0; i < clients.size(); i++) {
+    const string &sDestPath = destPaths[i];
+    size_t nSlashPos = sDestPath.rfind('/');
+    util::localfs::MakeDirs(sDestPath.substr(0, nSlashPos));
+    // each object is downloaded as a single file, even if it looks like a
+    // fragment of another
+    const ObjectClient &client = clients[i];
+    downloads.Submit([this, client, sDestPath, nFileConcurrency]() {
+      FileStream reader =
+          FileStream::OpenForReading(vector<ObjectClient>{client});
+      DownloadRanges(reader, sDestPath, nFileConcurrency);
+    });
+  }
+  downloads.Wait();
+}
+
+void Driver::CopyAllFrom(const string &sDirUrl, const string &sSourceDir) {
+  CheckConnected();
+  auto request = ParseUrl(sDirUrl);
+  if (!request->bDir)
+    throw invalid_argument("bulk copy destination URL must be a directory");
+
+  vector<string> relPaths = util::localfs::ListFilesRecursively(sSourceDir);
+  relPaths = RemoveTransferSidecars(relPaths);
+  if (request->storageType == SHARE) {
+    // Unlike blob paths, share directories must exist before their files.
+    // The parents of a directory are sorted before it.
+    set<string> relDirs;
+    for (const auto &sRelPath : relPaths) {
+      for (size_t nPos = sRelPath.find('/'); nPos != string::npos;
+           nPos = sRelPath.find('/', nPos + 1))
+        relDirs.insert(sRelPath.substr(0, nPos));
     }
+    auto dirClient = GetDirClient(*request);
+    for (const auto &sSegment : request->share.path)
+      dirClient = dirClient.GetSubdirectoryClient(sSegment);
+    for (const auto &sRelDir : relDirs) {
+      auto subdirClient = dirClient;
+      for (const auto &sSegment : util::str::Split(sRelDir, '/'))
+        subdirClient = subdirClient.GetSubdirectoryClient(sSegment);
+      subdirClient.CreateIfNotExists();
+    }
+  }
+
+  string sBaseUrl = util::str::EndsWith(sDirUrl, "/") ? sDirUrl : sDirUrl + "/";
+  size_t nFilesInFlight = min(relPaths.size(), config->nTransferConcurrency);
+  size_t nFileConcurrency =
+      GetFileTransferConcurrency(config->nTransferConcurrency, nFilesInFlight);
+  TaskGroup uploads(nFilesInFlight);
+  for (const auto &sRelPath : relPaths) {
+    // Local names may contain characters which are reserved in URLs
+    string sUrl;
+    for (const auto &sSegment : util::str::Split(sRelPath, '/'))
+      sUrl += (sUrl.empty() ? sBaseUrl : "/") +
+              Azure::Core::Url::Encode(sSegment);
+    uploads.Submit([this, sUrl, sSourceDir, sRelPath, nFileConcurrency]() {
+      UploadFile(*ParseUrl(sUrl), sSourceDir + "/" + sRelPath,
+                 nFileConcurrency);
+    });
   }
+  uploads.Wait();
 }
 
 void Driver::Concatenate(const vector<string> &inputUrls,
                          const string &sDestUrl) {
   CheckConnected();
-  if (inputUrls.size() < 2)
+  // a single input may still have several fragments to merge
+  if (inputUrls.empty())
     return; // nothing to do
 
-  vector<ServiceRequest> inputs;
+  vector<shared_ptr<const ServiceRequest>> inputs;
   transform(inputUrls.begin(), inputUrls.end(), back_inserter(inputs),
             [this](const string &sInputUrl) { return ParseUrl(sInputUrl); });
-  ServiceRequest output = ParseUrl(sDestUrl);
+  auto output = ParseUrl(sDestUrl);
 
   for (const auto &input : inputs) {
-    if (input.storageType != output.storageType)
+    if (input->storageType != output->storageType)
       throw invalid_argument("input storage type (BLOB/SHARE) is inconsistent "
                              "with output storage type");
-    if (input.bDir)
+    if (input->bDir)
       throw invalid_argument("concatenation is not supported for directories");
   }
-  if (output.bDir)
+  if (output->bDir)
     throw invalid_argument(
         "concatenation destination URL cannot be a directory");
 
   vector<FragmentedFile> fragmentedFiles;
-  if (output.storageType == BLOB) {
-    transform(
-        inputs.begin(), inputs.end(), back_inserter(fragmentedFiles),
-        [this](const auto &input) { return FragmentedFile(ListBlobs(input)); });
-  } else // SHARE
-  {
-    transform(
-        inputs.begin(), inputs.end(), back_inserter(fragmentedFiles),
-        [this](const auto &input) { return FragmentedFile(ListFiles(input)); });
-  }
+  transform(inputs.begin(), inputs.end(), back_inserter(fragmentedFiles),
+            [this](const auto &input) { return OpenFragmentedFile(*input); });
   size_t nHeaderLen = fragmentedFiles.front().GetHeaderLen();
   if (any_of(fragmentedFiles.begin() + 1, fragmentedFiles.end(),
              [nHeaderLen](const auto &fragmentedFile) {
@@ -542,40 +1069,205 @@ void Driver::Concatenate(const vector<string> &inputUrls,
     throw invalid_argument("input fragment headers are incompatible");
   }
 
-  if (output.storageType == BLOB) {
-    auto destBlob = GetBlobClient(output).AsBlockBlobClient();
-    vector<string> destBlockIds;
-    Azure::Core::Http::HttpRange range;
-    for (size_t nInputIndex = 0; nInputIndex != inputs.size(); nInputIndex++) {
-      string sBlockIdInBase10 =
-          (ostringstream() << setfill('0') << setw(64) << destBlockIds.size())
-              .str();
-      vector<uint8_t> blockIdInBase10(sBlockIdInBase10.begin(),
-                                      sBlockIdInBase10.end());
-      string sBlockIdInBase64 =
-          Azure::Core::Convert::Base64Encode(blockIdInBase10);
-      destBlockIds.push_back(sBlockIdInBase64);
-
-      range.Offset = nInputIndex == 0 ? 0 : nHeaderLen;
-      Azure::Storage::Blobs::StageBlockFromUriOptions opts;
-      opts.SourceRange = range;
-      destBlob.StageBlockFromUri(sBlockIdInBase64,
-                                 inputs[nInputIndex].azureUrl.GetAbsoluteUrl(),
-                                 opts);
-    }
-    destBlob.CommitBlockList(destBlockIds);
+  if (output->storageType == BLOB) {
+    ConcatenateBlobs(inputs, fragmentedFiles, *output);
   } else // SHARE
   {
-    auto destFile = GetFileClient(output);
-    destFile.Create(0LL);
-    size_t nOffset = 0ULL;
-    Azure::Core::Http::HttpRange range;
-    for (size_t nInputIndex = 0; nInputIndex != inputs.size(); nInputIndex++) {
-      range.Offset = nInputIndex == 0 ? 0 : nHeaderLen;
-      destFile.UploadRangeFromUri(
-          nOffset, inputs[nInputIndex].azureUrl.GetAbsoluteUrl(), range);
-      nOffset += fragmentedFiles[nInputIndex].GetSize();
+    ConcatenateShareFiles(inputs, fragmentedFiles, *output);
+  }
+}
+
+// Calls copyRange, in order, on the ranges of the fragments of the inputs
+// making up their concatenation, of at most nMaxRangeSize bytes. The header is
+// only kept at the start of the output: the content size of the first
+// fragment of each input includes it, unlike the others.
+static void ForEachConcatenatedRange(
+    const vector<FragmentedFile> &fragmentedFiles, size_t nMaxRangeSize,
+    const function<void(size_t nInputIndex,
+                        const FragmentedFile::Fragment &fragment,
+                        const Azure::Core::Http::HttpRange &range)>
+        &copyRange) {
+  size_t nHeaderLen = fragmentedFiles.front().GetHeaderLen();
+  for (size_t nInputIndex = 0; nInputIndex != fragmentedFiles.size();
+       nInputIndex++) {
+    const auto &fragmentedFile = fragmentedFiles[nInputIndex];
+    for (size_t nFragmentIndex = 0;
+         nFragmentIndex != fragmentedFile.GetFragmentCount();
+         nFragmentIndex++) {
+      const auto &fragment = fragmentedFile.GetFragment(nFragmentIndex);
+      size_t nOffset =
+          nInputIndex == 0 && nFragmentIndex == 0 ? 0 : nHeaderLen;
+      size_t nEnd = nFragmentIndex == 0 ? fragment.nContentSize
+                                        : nHeaderLen + fragment.nContentSize;
+      for (; nOffset < nEnd; nOffset += nMaxRangeSize) {
+        copyRange(nInputIndex, fragment,
+                  Azure::Core::Http::HttpRange{
+                      (int64_t)nOffset,
+                      (int64_t)min(nMaxRangeSize, nEnd - nOffset)});
+      }
+    }
+  }
+}
+
+void Driver::ConcatenateBlobs(
+    const vector<shared_ptr<const ServiceRequest>> &inputs,
+    const vector<FragmentedFile> &fragmentedFiles,
+    const ServiceRequest &output) const {
+  auto destBlob = GetBlobClient(output).AsBlockBlobClient();
+  vector<CopySourceAuthorization> sourceAuthorizations;
+  for (const auto &input : inputs)
+    sourceAuthorizations.push_back(clientPool->GetCopySourceAuthorization(
+        GetServiceUrl(*input), input->bEmulated));
+
+  vector<string> destBlockIds;
+  TaskGroup stagings(config->nTransferConcurrency);
+  ForEachConcatenatedRange(
+      fragmentedFiles, nMaxBlockFromUriSize,
+      [&](size_t nInputIndex, const FragmentedFile::Fragment &fragment,
+          const Azure::Core::Http::HttpRange &range) {
+        if (destBlockIds.size() == nMaxBlockCount)
+          throw TooManyBlocksError(nMaxBlockCount);
+        string sBlockId = MakeBlockId(destBlockIds.size());
+        const auto &sourceAuthorization = sourceAuthorizations[nInputIndex];
+        string sSourceUrl =
+            sourceAuthorization.GetSourceUrl(fragment.client.GetUrl());
+        Azure::Storage::Blobs::StageBlockFromUriOptions opts;
+        opts.SourceRange = range;
+        // share file ETags cannot be used as copy source conditions
+        if (fragment.client.tag == BLOB)
+          opts.SourceAccessConditions.IfMatch = fragment.etag;
+        if (!sourceAuthorization.sAuthorization.empty())
+          opts.SourceAuthorization = sourceAuthorization.sAuthorization;
+        stagings.Submit([destBlob, sBlockId, sSourceUrl, opts]() {
+          destBlob.StageBlockFromUri(sBlockId, sSourceUrl, opts);
+        });
+        destBlockIds.push_back(sBlockId);
+      });
+  stagings.Wait();
+  destBlob.CommitBlockList(destBlockIds);
+}
+
+void Driver::ConcatenateShareFiles(
+    const vector<shared_ptr<const ServiceRequest>> &inputs,
+    const vector<FragmentedFile> &fragmentedFiles,
+    const ServiceRequest &output) const {
+  // The output is created at its final size, for the ranges to be copied to
+  // their offset in any order
+  size_t nHeaderLen = fragmentedFiles.front().GetHeaderLen();
+  size_t nDestSize = 0;
+  for (size_t nInputIndex = 0; nInputIndex != fragmentedFiles.size();
+       nInputIndex++) {
+    nDestSize += fragmentedFiles[nInputIndex].GetSize() -
+                 (nInputIndex == 0 ? 0 : nHeaderLen);
+  }
+  auto destFile = GetFileClient(output);
+  destFile.Create((int64_t)nDestSize);
+
+  vector<CopySourceAuthorization> sourceAuthorizations;
+  for (const auto &input : inputs)
+    sourceAuthorizations.push_back(clientPool->GetCopySourceAuthorization(
+        GetServiceUrl(*input), input->bEmulated));
+
+  size_t nDestOffset = 0;
+  TaskGroup copies(config->nTransferConcurrency);
+  ForEachConcatenatedRange(
+      fragmentedFiles, nMaxRangeSize,
+      [&](size_t nInputIndex, const FragmentedFile::Fragment &fragment,
+          const Azure::Core::Http::HttpRange &range) {
+        const auto &sourceAuthorization = sourceAuthorizations[nInputIndex];
+        string sSourceUrl =
+            sourceAuthorization.GetSourceUrl(fragment.client.GetUrl());
+        Azure::Storage::Files::Shares::UploadFileRangeFromUriOptions opts;
+        if (!sourceAuthorization.sAuthorization.empty())
+          opts.SourceAuthorization = sourceAuthorization.sAuthorization;
+        copies.Submit([destFile, nDestOffset, sSourceUrl, range, opts]() {
+          destFile.UploadRangeFromUri((int64_t)nDestOffset, sSourceUrl, range,
+                                      opts);
+        });
+        nDestOffset += (size_t)range.Length.Value();
+      });
+  copies.Wait();
+}
+
+void Driver::Copy(const string &sSourceUrl, const string &sDestUrl) {
+  CheckConnected();
+  auto source = ParseUrl(sSourceUrl);
+  auto dest = ParseUrl(sDestUrl);
+  if (source->bDir || dest->bDir)
+    throw InvalidOperationForDirError(DirOperation::COPY);
+
+  vector<FragmentedFile> fragmentedFiles;
+  fragmentedFiles.push_back(OpenFragmentedFile(*source));
+  const auto &fragmentedFile = fragmentedFiles.front();
+  if (dest->storageType == BLOB) {
+    // Blobs small enough are copied by the service in a single request,
+    // larger ones by blocks staged concurrently
+    if (fragmentedFile.GetFragmentCount() == 1 &&
+        fragmentedFile.GetFragment(0).client.tag == BLOB &&
+        fragmentedFile.GetSize() <= nMaxCopyFromUriSize) {
+      const auto &fragment = fragmentedFile.GetFragment(0);
+      Azure::Storage::Blobs::CopyBlobFromUriOptions opts;
+      opts.SourceAccessConditions.IfMatch = fragment.etag;
+      auto sourceAuthorization = clientPool->GetCopySourceAuthorization(
+          GetServiceUrl(*source), source->bEmulated);
+      if (!sourceAuthorization.sAuthorization.empty())
+        opts.SourceAuthorization = sourceAuthorization.sAuthorization;
+      GetBlobClient(*dest).CopyFromUri(
+          sourceAuthorization.GetSourceUrl(fragment.client.GetUrl()), opts);
+    } else {
+      ConcatenateBlobs({source}, fragmentedFiles, *dest);
     }
+  } else // SHARE
+  {
+    CheckParentDirExists(*dest);
+    ConcatenateShareFiles({source}, fragmentedFiles, *dest);
+  }
+}
+
+void Driver::Move(const string &sSourceUrl, const string &sDestUrl) {
+  CheckConnected();
+  auto source = ParseUrl(sSourceUrl);
+  auto dest = ParseUrl(sDestUrl);
+  if (source->bDir || dest->bDir)
+    throw InvalidOperationForDirError(DirOperation::MOVE);
+  // the source would otherwise be removed once copied onto itself
+  if (source->azureUrl.GetAbsoluteUrl() == dest->azureUrl.GetAbsoluteUrl())
+    return;
+
+  // Share files are renamed within their share, without copying their data
+  if (source->storageType == SHARE && dest->storageType == SHARE &&
+      GetServiceUrl(*source) == GetServiceUrl(*dest) &&
+      source->share.sShare == dest->share.sShare &&
+      all_of(source->share.path.begin(), source->share.path.end(),
+             [](const string &sSegment) {
+               return util::glob::FindGlobbingChar(sSegment) == string::npos;
+             })) {
+    CheckParentDirExists(*dest);
+    string sDestPath;
+    for (const auto &sSegment : dest->share.path)
+      sDestPath += (sDestPath.empty() ? "" : "/") + sSegment;
+    Azure::Storage::Files::Shares::RenameFileOptions opts;
+    opts.ReplaceIfExists = true;
+    GetFileClient(*source).Rename(sDestPath, opts);
+    return;
+  }
+
+  Copy(sSourceUrl, sDestUrl);
+  Remove(sSourceUrl);
+}
+
+FragmentedFile Driver::OpenFragmentedFile(const ServiceRequest &request) const {
+  if (request.storageType == BLOB) {
+    auto blobs = ListBlobs(request);
+    if (blobs.empty())
+      throw NoFileError(request.azureUrl.GetAbsoluteUrl());
+    return FragmentedFile(blobs);
+  } else // SHARE
+  {
+    auto files = ListFiles(request);
+    if (files.empty())
+      throw NoFileError(request.azureUrl.GetAbsoluteUrl());
+    return FragmentedFile(files);
   }
 }
 
@@ -585,12 +1277,16 @@ void Driver::CheckConnected() const {
   }
 }
 
-bool Driver::IsEmulatedStorage() const {
-  return util::str::ToLower(util::env::GetEnvironmentVariableOrDefault(
-             "AZURE_EMULATED_STORAGE", "false")) != "false";
+shared_ptr<const ServiceRequest> Driver::ParseUrl(const string &sUrl) const {
+  shared_ptr<const ServiceRequest> request;
+  if (!parsedUrlCache->Find(sUrl, request)) {
+    request = make_shared<const ServiceRequest>(ParseUrlUncached(sUrl));
+    parsedUrlCache->Insert(sUrl, request);
+  }
+  return request;
 }
 
-ServiceRequest Driver::ParseUrl(const string &sUrl) const {
+ServiceRequest Driver::ParseUrlUncached(const string &sUrl) const {
   const string sBlobDomain = ".blob.core.windows.net";
   const string sFileDomain = ".file.core.windows.net";
   Azure::Core::Url url;
@@ -600,81 +1296,97 @@ ServiceRequest Driver::ParseUrl(const string &sUrl) const {
     throw InvalidUrlError(sUrl);
   }
   const string &sHost = url.GetHost();
+  // The object names are decoded from the path, the clients encoding them
   const string &sPath = url.GetPath();
   bool bDir = util::str::EndsWith(sPath, "/");
-  if (IsEmulatedStorage()) // Can only be a blob storage as only blob storages
-                           // are supported by the emulator
+  vector<string> parts;
+  StorageType storageType;
+  if (config->bEmulatedStorage) // Can only be a blob storage as only blob
+                                // storages are supported by the emulator
   {
-    smatch match;
-    if (!regex_match(
-            sPath, match,
-            regex("([^/]+)/([^/]+)/(.+)"))) //  accountname/container/object or
-                                            //  accountname/container/object/
-    {
+    //  accountname/container/object  or  accountname/container/object/
+    if (!util::path::SplitLeadingSegments(sPath, 2, parts)) {
       throw InvalidObjectPathError(sPath);
     }
-    auto connectionString =
-        util::connstr::ConnectionString::ParseConnectionString(
-            util::env::GetEnvironmentVariableOrThrow(
-                "AZURE_STORAGE_CONNECTION_STRING"));
     if (!util::str::StartsWith(url.GetAbsoluteUrl(),
-                              connectionString.blobEndpoint.GetAbsoluteUrl())) {
+                               config->sEmulatedBlobEndpoint)) {
       throw IncompatibleConnectionStringError();
     }
-    auto credential = make_shared<Azure::Storage::StorageSharedKeyCredential>(
-        connectionString.sAccountName, connectionString.sAccountKey);
     return ServiceRequest(
-        url, BLOB, bDir,
-        BlobInfo{match[1].str(), match[2].str(), match[3].str()}, credential);
-  } else if (util::str::EndsWith(sHost, sBlobDomain)) {
-    smatch match;
-    if (!regex_match(
-            sPath, match,
-            regex("([^/]+)/(.+)"))) //  container/object  or  container/object/
-    {
+        url, BLOB, true, bDir,
+        BlobInfo{parts[0], parts[1], Azure::Core::Url::Decode(parts[2])});
+  } else if (!util::url::GetStorageType(sHost, storageType)) {
+    throw InvalidDomainError(sHost);
+  } else if (storageType == BLOB) {
+    //  container/object  or  container/object/
+    if (!util::path::SplitLeadingSegments(sPath, 1, parts)) {
       throw InvalidObjectPathError(sPath);
     }
-    auto credential = make_shared<Azure::Identity::ChainedTokenCredential>(
-        Azure::Identity::ChainedTokenCredential::Sources{
-            std::make_shared<
-                Azure::Identity::EnvironmentCredential>(), // for Client ID +
-                                                           // Client Secret or
-                                                           // Certificate
-                                                           // environment
-                                                           // variables
-            std::make_shared<Azure::Identity::WorkloadIdentityCredential>(),
-            std::make_shared<Azure::Identity::ManagedIdentityCredential>(),
-            std::make_shared<Azure::Identity::AzureCliCredential>()});
-    return ServiceRequest(url, BLOB, bDir,
-                          BlobInfo{string(), match[1].str(), match[2].str()},
-                          credential);
-  } else if (util::str::EndsWith(sHost, sFileDomain)) {
-    smatch match;
-    if (!regex_match(
-            sPath, match,
-            regex("([^/]+)((?:/[^/]+)+/?)"))) //  share/path/to/a/file  or
-                                              //  share/path/to/a/dir/
-    {
+    return ServiceRequest(
+        url, BLOB, false, bDir,
+        BlobInfo{string(), parts[0], Azure::Core::Url::Decode(parts[1])});
+  } else // SHARE
+  {
+    //  share/path/to/a/file  or  share/path/to/a/dir/
+    vector<string> fileOrDirPath;
+    if (!util::path::SplitLeadingSegments(sPath, 1, parts) ||
+        !util::path::SplitSegments(parts[1], fileOrDirPath)) {
       throw InvalidObjectPathError(sPath);
     }
-    vector<string> fileOrDirPath =
-        util::str::Split(match[2].str(), '/', -1, true);
-    auto credential = make_shared<Azure::Identity::ChainedTokenCredential>(
-        Azure::Identity::ChainedTokenCredential::Sources{
-            std::make_shared<
-                Azure::Identity::EnvironmentCredential>(), // for Client ID +
-                                                           // Client Secret or
-                                                           // Certificate
-                                                           // environment
-                                                           // variables
-            std::make_shared<Azure::Identity::WorkloadIdentityCredential>(),
-            std::make_shared<Azure::Identity::ManagedIdentityCredential>(),
-            std::make_shared<Azure::Identity::AzureCliCredential>()});
-    return ServiceRequest(url, SHARE, bDir,
-                          ShareInfo{match[1].str(), fileOrDirPath}, credential);
-  } else {
-    throw InvalidDomainError(sHost);
+    for (auto &sSegment : fileOrDirPath)
+      sSegment = Azure::Core::Url::Decode(sSegment);
+    return ServiceRequest(url, SHARE, false, bDir,
+                          ShareInfo{parts[0], fileOrDirPath});
+  }
+}
+
+void Driver::Sync() {
+  CheckConnected();
+  if (asyncCloses)
+    asyncCloses->Wait();
+  vector<string> errors;
+  {
+    lock_guard<mutex> lock(asyncCloseErrorsMutex);
+    errors.swap(asyncCloseErrors);
   }
+  if (!errors.empty())
+    throw AsyncCloseError(errors.size(), errors.front());
+}
+
+FileStream &Driver::OpenPartForWriting(const string &sUrl, size_t nPart) {
+  CheckConnected();
+  auto request = ParseUrl(sUrl);
+  if (request->storageType != BLOB)
+    throw UnsupportedStorageError("writing a file in parts");
+  if (request->bDir)
+    throw InvalidOperationForDirError(DirOperation::WRITE);
+  return RegisterFileStream(
+      FileStream::OpenPartForWriting(GetBlobClient(*request), config, nPart));
+}
+
+void Driver::CommitParts(const string &sUrl) const {
+  CheckConnected();
+  auto request = ParseUrl(sUrl);
+  if (request->storageType != BLOB)
+    throw UnsupportedStorageError("writing a file in parts");
+  if (request->bDir)
+    throw InvalidOperationForDirError(DirOperation::WRITE);
+
+  auto client = GetBlobClient(*request).AsBlockBlobClient();
+  vector<string> stagedBlockIds;
+  try {
+    Azure::Storage::Blobs::GetBlockListOptions opts;
+    opts.ListType =
+        Azure::Storage::Blobs::Models::BlockListType::Uncommitted;
+    for (const auto &block : client.GetBlockList(opts).Value.UncommittedBlocks)
+      stagedBlockIds.push_back(block.Name);
+  } catch (const Azure::Storage::StorageException &exc) {
+    // with no block staged, the blob may not exist yet
+    if (exc.StatusCode != Azure::Core::Http::HttpStatusCode::NotFound)
+      throw;
+  }
+  // The blocks which are not committed are discarded by the service
+  client.CommitBlockList(GetPartBlockIds(stagedBlockIds));
 }
 
 string Driver::GetServiceUrl(const ServiceRequest &request) const {
@@ -700,43 +1412,21 @@ string Driver::GetServiceUrl(const ServiceRequest &request) const {
   }
 }
 
-string Driver::GetBlobContainerUrl(const ServiceRequest &request) const {
-  return (ostringstream() << GetServiceUrl(request) << "/"
-                          << request.blob.sContainer)
-      .str();
-}
-
 Azure::Storage::Blobs::BlobServiceClient
 Driver::GetBlobServiceClient(const ServiceRequest &request) const {
-  if (request.bEmulated) {
-    return Azure::Storage::Blobs::BlobServiceClient(
-        GetServiceUrl(request), request.emulatedStorageCredential);
-  } else {
-    return Azure::Storage::Blobs::BlobServiceClient(
-        GetServiceUrl(request), request.cloudStorageCredential);
-  }
+  return clientPool->GetBlobServiceClient(GetServiceUrl(request),
+                                          request.bEmulated);
 }
 
 Azure::Storage::Blobs::BlobContainerClient
 Driver::GetBlobContainerClient(const ServiceRequest &request) const {
-  if (request.bEmulated) {
-    return Azure::Storage::Blobs::BlobContainerClient(
-        GetBlobContainerUrl(request), request.emulatedStorageCredential);
-  } else {
-    return Azure::Storage::Blobs::BlobContainerClient(
-        GetBlobContainerUrl(request), request.cloudStorageCredential);
-  }
+  return GetBlobServiceClient(request).GetBlobContainerClient(
+      request.blob.sContainer);
 }
 
 Azure::Storage::Blobs::BlobClient
 Driver::GetBlobClient(const ServiceRequest &request) const {
-  if (request.bEmulated) {
-    return Azure::Storage::Blobs::BlobClient(request.azureUrl.GetAbsoluteUrl(),
-                                             request.emulatedStorageCredential);
-  } else {
-    return Azure::Storage::Blobs::BlobClient(request.azureUrl.GetAbsoluteUrl(),
-                                             request.cloudStorageCredential);
-  }
+  return GetBlobContainerClient(request).GetBlobClient(request.blob.sBlob);
 }
 
 vector<Azure::Storage::Blobs::BlobClient>
@@ -745,25 +1435,15 @@ Driver::ListBlobs(const ServiceRequest &request) const {
                                   request.blob.sBlob);
 }
 
-string Driver::GetFileShareUrl(const ServiceRequest &request) const {
-  return (ostringstream() << GetServiceUrl(request) << "/"
-                          << request.share.sShare)
-      .str();
-}
-
 Azure::Storage::Files::Shares::ShareServiceClient
 Driver::GetFileShareServiceClient(const ServiceRequest &request) const {
-  return Azure::Storage::Files::Shares::ShareServiceClient(
-      GetServiceUrl(request), request.cloudStorageCredential);
+  return clientPool->GetShareServiceClient(GetServiceUrl(request));
 }
 
 Azure::Storage::Files::Shares::ShareClient
 Driver::GetShareClient(const ServiceRequest &request) const {
-  Azure::Storage::Files::Shares::ShareClientOptions opts;
-  opts.ShareTokenIntent =
-      Azure::Storage::Files::Shares::Models::ShareTokenIntent::Backup;
-  return Azure::Storage::Files::Shares::ShareClient(
-      GetFileShareUrl(request), request.cloudStorageCredential, opts);
+  return GetFileShareServiceClient(request).GetShareClient(
+      request.share.sShare);
 }
 
 Azure::Storage::Files::Shares::ShareDirectoryClient
@@ -773,11 +1453,12 @@ Driver::GetDirClient(const ServiceRequest &request) const {
 
 Azure::Storage::Files::Shares::ShareFileClient
 Driver::GetFileClient(const ServiceRequest &request) const {
-  Azure::Storage::Files::Shares::ShareClientOptions opts;
-  opts.ShareTokenIntent =
-      Azure::Storage::Files::Shares::Models::ShareTokenIntent::Backup;
-  return Azure::Storage::Files::Shares::ShareFileClient(
-      request.azureUrl.GetAbsoluteUrl(), request.cloudStorageCredential, opts);
+  auto dirClient = GetDirClient(request);
+  for (auto it = request.share.path.begin();
+       it != request.share.path.end() - 1; it++) {
+    dirClient = dirClient.GetSubdirectoryClient(*it);
+  }
+  return dirClient.GetFileClient(request.share.path.back());
 }
 
 vector<Azure::Storage::Files::Shares::ShareDirectoryClient>
@@ -836,7 +1517,7 @@ void Driver::CheckParentDirExists(const ServiceRequest &request) const {
 
 FileStream &Driver::RegisterFileStream(FileStream &&fileStream) {
   void *handle = fileStream.GetHandle();
-  fileStreams[handle] = make_unique<FileStream>(move(fileStream));
+  fileStreams[handle] = make_unique<FileStream>(std::move(fileStream));
   return *fileStreams.at(handle);
 }
 
@@ -9,18 +9,25 @@ struct ServiceRequest;
 class Driver;
 } // namespace az
 
+#include "clientpool.hpp"
+#include "config.hpp"
 #include "filestream.hpp"
+#include "lrucache.hpp"
 #include "macro.hpp"
+#include "taskgroup.hpp"
 #include <azure/storage/blobs/blob_client.hpp>
 #include <azure/storage/blobs/blob_container_client.hpp>
 #include <azure/storage/blobs/blob_service_client.hpp>
+#include <azure/storage/blobs/block_blob_client.hpp>
 #include <azure/storage/files/shares/share_client.hpp>
 #include <azure/storage/files/shares/share_directory_client.hpp>
 #include <azure/storage/files/shares/share_file_client.hpp>
 #include <azure/storage/files/shares/share_service_client.hpp>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 // Release versions must have 3 digits, for example STRINGIFY(1.2.0)
 // Alpha, beta ou release candidates have an extra suffix, for example :
@@ -33,7 +40,6 @@ namespace az {
 static const std::string sName = "Azure driver";
 static const std::string sVersion = DRIVER_VERSION;
 static const std::string sScheme = "https";
-static constexpr size_t nDefaultPreferredBufferSize = 4 * 1024 * 1024;
 
 struct BlobInfo {
   std::string sAccountName;
@@ -55,28 +61,10 @@ struct ServiceRequest {
     BlobInfo blob;
     ShareInfo share;
   };
-  union {
-    std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>
-        emulatedStorageCredential;
-    std::shared_ptr<Azure::Core::Credentials::TokenCredential>
-        cloudStorageCredential;
-  };
-  ServiceRequest(const Azure::Core::Url azureUrl, StorageType storageType,
-                 bool bDir, const BlobInfo &blob,
-                 std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>
-                     emulatedStorageCredential);
-  ServiceRequest(const Azure::Core::Url azureUrl, StorageType storageType,
-                 bool bDir, const BlobInfo &blob,
-                 std::shared_ptr<Azure::Core::Credentials::TokenCredential>
-                     cloudStorageCredential);
   ServiceRequest(const Azure::Core::Url azureUrl, StorageType storageType,
-                 bool bDir, const ShareInfo &share,
-                 std::shared_ptr<Azure::Storage::StorageSharedKeyCredential>
-                     emulatedStorageCredential);
+                 bool bEmulated, bool bDir, const BlobInfo &blob);
   ServiceRequest(const Azure::Core::Url azureUrl, StorageType storageType,
-                 bool bDir, const ShareInfo &share,
-                 std::shared_ptr<Azure::Core::Credentials::TokenCredential>
-                     cloudStorageCredential);
+                 bool bEmulated, bool bDir, const ShareInfo &share);
   ServiceRequest(const ServiceRequest &other);
   ~ServiceRequest();
 };
@@ -101,6 +89,8 @@ public:
   FileStream &OpenForReading(const std::string &sUrl);
   FileStream &OpenForWriting(const std::string &sUrl);
   FileStream &OpenForAppending(const std::string &sUrl);
+  // With asynchronous closing enabled, the file is closed in the background
+  // and its errors are only reported by Sync
   void Close(void *handle);
   size_t Read(void *handle, void *dest, size_t nSize, size_t nCount);
   void Seek(void *handle, long long int nOffset, int nOrigin);
@@ -112,17 +102,81 @@ public:
   size_t GetFreeDiskSpace() const;
   void CopyTo(const std::string &sUrl, const std::string &destUrl);
   void CopyFrom(const std::string &sUrl, const std::string &sourceUrl);
+  // Bulk copies, of several files at once: the objects matching the pattern
+  // are downloaded to the local directory, at their path relative to the
+  // directory of the pattern, and the files of the local directory are
+  // uploaded below the directory URL, at their relative path
+  void CopyAllTo(const std::string &sPatternUrl, const std::string &sDestDir);
+  void CopyAllFrom(const std::string &sDirUrl, const std::string &sSourceDir);
   void Concatenate(const std::vector<std::string> &inputUrls,
                    const std::string &sDestUrl);
+  // Waits for the files being closed in the background
+  void Sync();
+  // Server-side copies between storage URLs, possibly of different storage
+  // types. The source may be a fragmented file, copied as a single file.
+  void Copy(const std::string &sSourceUrl, const std::string &sDestUrl);
+  void Move(const std::string &sSourceUrl, const std::string &sDestUrl);
+  // Parts of a blob written by several writers, which are only visible once
+  // committed together
+  FileStream &OpenPartForWriting(const std::string &sUrl, size_t nPart);
+  void CommitParts(const std::string &sUrl) const;
 
 private:
   void CheckConnected() const;
-  bool IsEmulatedStorage() const;
-
-  ServiceRequest ParseUrl(const std::string &sUrl) const;
+  // Throws NoFileError if no file matches the request
+  FragmentedFile OpenFragmentedFile(const ServiceRequest &request) const;
+  // Downloads the file read by the reader to a local file, by ranges
+  // downloaded concurrently and written at their offset. With resumable
+  // transfers, the downloaded ranges are recorded in a checkpoint next to the
+  // local file. With sync transfers, the download is skipped if the local
+  // file was downloaded from the same version of the file and not modified
+  // since, as recorded in a manifest next to it.
+  void DownloadRanges(const FileStream &reader, const std::string &sDestPath,
+                      size_t nConcurrency) const;
+  // Uploads a local file, by ranges or blocks uploaded concurrently. With
+  // sync transfers, the upload is skipped if the destination has the size
+  // and MD5 of the local file.
+  void UploadFile(const ServiceRequest &request, const std::string &sourceUrl,
+                  size_t nTransferConcurrency) const;
+  // Uploads a local file by blocks staged concurrently and committed once,
+  // reusing the blocks staged by an interrupted upload of the same file
+  void UploadBlocks(const std::string &sSourcePath, size_t nSize,
+                    size_t nBlockSize,
+                    const Azure::Storage::Blobs::BlockBlobClient &client,
+                    const Azure::Storage::Blobs::Models::BlobHttpHeaders
+                        &httpHeaders,
+                    size_t nConcurrency) const;
+  // Copies the fragments of the inputs to the output by concurrent copies of
+  // ranges of at most the size the service can copy at once. The blocks of
+  // blobs are then committed in order.
+  void ConcatenateBlobs(
+      const std::vector<std::shared_ptr<const ServiceRequest>> &inputs,
+      const std::vector<FragmentedFile> &fragmentedFiles,
+      const ServiceRequest &output) const;
+  void ConcatenateShareFiles(
+      const std::vector<std::shared_ptr<const ServiceRequest>> &inputs,
+      const std::vector<FragmentedFile> &fragmentedFiles,
+      const ServiceRequest &output) const;
+  // Deletes blobs of the container of the request by concurrent batches, or
+  // by concurrent single deletions if the service rejects the batches. All
+  // the blobs are attempted and the failures reported as a DeletionsError.
+  void DeleteBlobs(
+      const ServiceRequest &request,
+      const std::vector<Azure::Storage::Blobs::BlobClient> &blobs) const;
+  // Deletes share files concurrently, all of them being attempted
+  void DeleteShareFiles(
+      const std::vector<Azure::Storage::Files::Shares::ShareFileClient> &files)
+      const;
+  // Deletes a share directory with all its content: the tree is listed level
+  // by level, the files of each level being deleted concurrently, and the
+  // directories are deleted bottom-up once empty
+  void DeleteShareDirRecursively(
+      const Azure::Storage::Files::Shares::ShareDirectoryClient &dir) const;
+
+  std::shared_ptr<const ServiceRequest> ParseUrl(const std::string &sUrl) const;
+  ServiceRequest ParseUrlUncached(const std::string &sUrl) const;
 
   std::string GetServiceUrl(const ServiceRequest &request) const;
-  std::string GetBlobContainerUrl(const ServiceRequest &request) const;
   Azure::Storage::Blobs::BlobServiceClient
   GetBlobServiceClient(const ServiceRequest &request) const;
   Azure::Storage::Blobs::BlobContainerClient
@@ -132,7 +186,6 @@ private:
   std::vector<Azure::Storage::Blobs::BlobClient>
   ListBlobs(const ServiceRequest &request) const;
 
-  std::string GetFileShareUrl(const ServiceRequest &request) const;
   Azure::Storage::Files::Shares::ShareServiceClient
   GetFileShareServiceClient(const ServiceRequest &request) const;
   Azure::Storage::Files::Shares::ShareClient
@@ -154,8 +207,17 @@ private:
 
   bool bIsConnected;
 
-  size_t nPreferredBufferSize;
+  std::shared_ptr<const Config> config;
+  std::unique_ptr<ClientPool> clientPool;
+
+  using ParsedUrlCache =
+      LruCache<std::string, std::shared_ptr<const ServiceRequest>>;
+  std::unique_ptr<ParsedUrlCache> parsedUrlCache;
 
   std::unordered_map<void *, std::unique_ptr<FileStream>> fileStreams;
+
+  std::unique_ptr<TaskGroup> asyncCloses;
+  std::mutex asyncCloseErrorsMutex;
+  std::vector<std::string> asyncCloseErrors;
 };
 } // namespace az
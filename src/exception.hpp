@@ -87,7 +87,7 @@ public:
                   .str()) {}
 };
 
-enum class DirOperation { GET_SIZE, READ, WRITE, APPEND, REMOVE, COPY };
+enum class DirOperation { GET_SIZE, READ, WRITE, APPEND, REMOVE, COPY, MOVE };
 
 inline std::string FormatOperation(DirOperation operation) {
   switch (operation) {
@@ -103,6 +103,8 @@ inline std::string FormatOperation(DirOperation operation) {
     return "removing (use driver_rmdir instead)";
   case DirOperation::COPY:
     return "copying";
+  case DirOperation::MOVE:
+    return "moving";
   default:
     throw std::invalid_argument(
         (std::ostringstream() << "invalid DirOperation: " << (int)operation)
@@ -126,12 +128,31 @@ public:
             (std::ostringstream() << "no file exists at URL " << sUrl).str()) {}
 };
 
+class UnsafeRelativePathError : public Error {
+public:
+  inline UnsafeRelativePathError(const std::string &sUrl)
+      : Error((std::ostringstream()
+               << "file " << sUrl
+               << " cannot be copied below the destination directory")
+                  .str()) {}
+};
+
 class DeletionError : public Error {
 public:
   inline DeletionError(const std::string &sUrl)
       : Error((std::ostringstream() << "failed to delete " << sUrl).str()) {}
 };
 
+class DeletionsError : public Error {
+public:
+  inline DeletionsError(size_t nFailedFiles, const std::string &sFirstError)
+      : Error((std::ostringstream() << nFailedFiles
+                                    << " file(s) could not be deleted, "
+                                       "first error: "
+                                    << sFirstError)
+                  .str()) {}
+};
+
 class InvalidFileStreamModeError : public Error {
 public:
   inline InvalidFileStreamModeError(const std::string &sUrl, char mode)
@@ -197,4 +218,38 @@ public:
   inline ReadingUpdatedFileError()
       : Error("the file has been updated during the reading") {}
 };
+
+class AsyncCloseError : public Error {
+public:
+  inline AsyncCloseError(size_t nFailedFiles, const std::string &sFirstError)
+      : Error((std::ostringstream()
+               << nFailedFiles
+               << " file(s) closed in the background could not be written, "
+                  "first error: "
+               << sFirstError)
+                  .str()) {}
+};
+
+class TooManyBlocksError : public Error {
+public:
+  inline TooManyBlocksError(size_t nMaxBlockCount)
+      : Error((std::ostringstream() << "cannot write more than "
+                                    << nMaxBlockCount << " blocks to a blob")
+                  .str()) {}
+};
+
+class LocalFileError : public Error {
+public:
+  inline LocalFileError(const std::string &sPath)
+      : Error((std::ostringstream() << "failed to access local file " << sPath)
+                  .str()) {}
+};
+
+class UnsupportedStorageError : public Error {
+public:
+  inline UnsupportedStorageError(const std::string &sOperation)
+      : Error((std::ostringstream() << sOperation
+                                    << " is only supported by blob storage")
+                  .str()) {}
+};
 } // namespace az
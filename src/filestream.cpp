@@ -1,13 +1,24 @@
 #include "filestream.hpp"
+#include "blockid.hpp"
+#include "servicelimits.hpp"
+#include <algorithm>
+#include <azure/storage/blobs/append_blob_client.hpp>
 #include <azure/storage/blobs/block_blob_client.hpp>
 #include <azure/storage/common/storage_exception.hpp>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
+#include <spdlog/spdlog.h>
 #include <sstream>
 
 using namespace std;
 
 namespace az {
+// The block size doubles every nBlockSizeGrowthPeriod staged blocks
+static constexpr size_t nBlockSizeGrowthPeriod = nMaxBlockCount / 10;
+// Share files double in size when full, by 1 GiB at most
+static constexpr size_t nMaxShareFileGrowth = 1024 * 1024 * 1024;
+
 FileStream FileStream::OpenForReading(
     const std::vector<Azure::Storage::Blobs::BlobClient> &clients) {
   return OpenForReading(vector<ObjectClient>(clients.begin(), clients.end()));
@@ -31,49 +42,110 @@ FileStream::OpenForReading(const std::vector<ObjectClient> &clients) {
   return fs;
 }
 
-FileStream
-FileStream::OpenForWriting(OutputMode mode,
-                           const Azure::Storage::Blobs::BlobClient &client) {
-  return OpenForWriting(mode, ObjectClient(client));
+FileStream FileStream::OpenForWriting(
+    OutputMode mode, const Azure::Storage::Blobs::BlobClient &client,
+    const shared_ptr<const Config> &config,
+    const CopySourceAuthorization &copySourceAuthorization) {
+  return OpenForWriting(mode, ObjectClient(client), config,
+                        copySourceAuthorization);
 }
 
 FileStream FileStream::OpenForWriting(
     OutputMode mode,
-    const Azure::Storage::Files::Shares::ShareFileClient &client) {
-  return OpenForWriting(mode, ObjectClient(client));
+    const Azure::Storage::Files::Shares::ShareFileClient &client,
+    const shared_ptr<const Config> &config) {
+  return OpenForWriting(mode, ObjectClient(client), config,
+                        CopySourceAuthorization());
 }
 
-FileStream FileStream::OpenForWriting(OutputMode mode,
-                                      const ObjectClient &client) {
+FileStream FileStream::OpenForWriting(
+    OutputMode mode, const ObjectClient &client,
+    const shared_ptr<const Config> &config,
+    const CopySourceAuthorization &copySourceAuthorization) {
   FileStream fs;
   fs.storageType = client.tag;
   fs.mode = Mode::WRITE;
-  new (&fs.writeInfo) WriteInfo(mode, client, vector<string>());
+  new (&fs.writeInfo) WriteInfo(mode, client, config);
 
   if (fs.storageType == BLOB) {
-    if (fs.writeInfo.mode == OutputMode::APPEND) {
+    if (fs.writeInfo.mode == OutputMode::APPEND && config->bAppendBlobs) {
+      // existing block blobs are still appended to through their block list
+      try {
+        fs.writeInfo.bAppendBlob =
+            fs.writeInfo.client.blob.GetProperties().Value.BlobType ==
+            Azure::Storage::Blobs::Models::BlobType::AppendBlob;
+      } catch (const Azure::Storage::StorageException &exc) {
+        if (exc.StatusCode != Azure::Core::Http::HttpStatusCode::NotFound)
+          throw;
+        fs.writeInfo.client.blob.AsAppendBlobClient().CreateIfNotExists();
+        fs.writeInfo.bAppendBlob = true;
+      }
+      fs.writeInfo.bCommitted = fs.writeInfo.bAppendBlob;
+    }
+    if (fs.writeInfo.mode == OutputMode::APPEND && !fs.writeInfo.bAppendBlob) {
+      vector<Azure::Storage::Blobs::Models::BlobBlock> blocks;
+      Azure::ETag etag;
+      size_t nBlobSize = 0;
       try {
-        vector<Azure::Storage::Blobs::Models::BlobBlock> blocks;
         auto blockListRequestResponse =
             fs.writeInfo.client.blob.AsBlockBlobClient().GetBlockList();
         blocks = blockListRequestResponse.Value.CommittedBlocks;
+        etag = blockListRequestResponse.Value.ETag;
+        nBlobSize = (size_t)blockListRequestResponse.Value.BlobSize;
         transform(blocks.begin(), blocks.end(),
                   back_inserter(fs.writeInfo.blockIds),
                   [](const auto &block) { return block.Name; });
       } catch (const Azure::Storage::StorageException &) {
       }
+      fs.writeInfo.nNextBlockIndex = GetNextBlockIndex(fs.writeInfo.blockIds);
+      // Blobs uploaded in a single request have no blocks, so their content
+      // is staged again as blocks to be kept by the next commit
+      if (fs.writeInfo.blockIds.empty() && nBlobSize > 0)
+        fs.StageExistingContent(nBlobSize, etag, copySourceAuthorization);
+      else if (config->nCompactionBlockCount > 0 &&
+               blocks.size() >= config->nCompactionBlockCount)
+        fs.CompactBlocks(blocks, etag, copySourceAuthorization);
     }
   } else // SHARE storage
   {
-    if (fs.writeInfo.mode == OutputMode::WRITE)
-      fs.writeInfo.client.shareFile.Create(0);
-    else // APPEND mode
+    if (fs.writeInfo.mode == OutputMode::APPEND) {
       fs.nCurrentPos =
           (size_t)fs.writeInfo.client.shareFile.GetProperties().Value.FileSize;
+      fs.writeInfo.bShareFileCreated = true;
+    }
+    fs.writeInfo.nBufferOffset = fs.nCurrentPos;
+    fs.writeInfo.nAllocatedSize = fs.nCurrentPos;
+    // as with local files, the file exists, empty, once opened for writing
+    if (!fs.writeInfo.bShareFileCreated)
+      fs.ResizeShareFile(0);
   }
   return fs;
 }
 
+FileStream FileStream::OpenForShardedWriting(
+    const function<ObjectClient(size_t nPart)> &partClients,
+    const shared_ptr<const Config> &config) {
+  FileStream fs =
+      OpenForWriting(OutputMode::WRITE, partClients(0), config,
+                     CopySourceAuthorization());
+  fs.writeInfo.partClients = partClients;
+  return fs;
+}
+
+FileStream FileStream::OpenPartForWriting(
+    const Azure::Storage::Blobs::BlobClient &client,
+    const shared_ptr<const Config> &config, size_t nPart) {
+  FileStream fs = OpenForWriting(OutputMode::WRITE, client, config,
+                                 CopySourceAuthorization());
+  fs.writeInfo.bPartWriter = true;
+  fs.writeInfo.nPart = nPart;
+  fs.writeInfo.nAttempt =
+      (uint64_t)chrono::duration_cast<chrono::microseconds>(
+          chrono::system_clock::now().time_since_epoch())
+          .count();
+  return fs;
+}
+
 FileStream::FileStream(FileStream &&source)
     : handle(std::move(source.handle)),
       storageType(std::move(source.storageType)), mode(std::move(source.mode)),
@@ -98,18 +170,49 @@ FileStream::FileStream()
       nCurrentPos(0ULL) {}
 
 FileStream::WriteInfo::WriteInfo(OutputMode mode, const ObjectClient &client,
-                                 const std::vector<std::string> &blockIds)
-    : mode(mode), client(client), blockIds(blockIds) {}
+                                 const shared_ptr<const Config> &config)
+    : mode(mode), client(client), config(config), bAppendBlob(false),
+      nBlockSize(min(max(config->nWriteBlockSize, (size_t)1), nMaxBlockSize)),
+      uploads(make_unique<TaskGroup>(config->nWriteConcurrency)),
+      nNextBlockIndex(0), bCommitted(false), nUncommittedSize(0),
+      nBufferOffset(0), nAllocatedSize(0), bShareFileCreated(false), nPart(0),
+      nPartSize(0), bHeaderComplete(false), bPartFull(false),
+      bPartWriter(false), nAttempt(0) {}
 
 FileStream::WriteInfo::WriteInfo(WriteInfo &&source)
     : mode(std::move(source.mode)), client(source.client),
-      blockIds(std::move(source.blockIds)) {}
-
-FileStream::WriteInfo::~WriteInfo() { blockIds.clear(); }
+      config(std::move(source.config)), bAppendBlob(source.bAppendBlob),
+      blockIds(std::move(source.blockIds)),
+      buffer(std::move(source.buffer)),
+      sBufferBlockId(std::move(source.sBufferBlockId)),
+      nBlockSize(source.nBlockSize),
+      uploads(std::move(source.uploads)),
+      nNextBlockIndex(source.nNextBlockIndex), bCommitted(source.bCommitted),
+      nUncommittedSize(source.nUncommittedSize),
+      nBufferOffset(source.nBufferOffset),
+      nAllocatedSize(source.nAllocatedSize),
+      bShareFileCreated(source.bShareFileCreated),
+      partClients(std::move(source.partClients)), nPart(source.nPart),
+      nPartSize(source.nPartSize), sHeader(std::move(source.sHeader)),
+      bHeaderComplete(source.bHeaderComplete), bPartFull(source.bPartFull),
+      bPartWriter(source.bPartWriter), nAttempt(source.nAttempt) {}
+
+FileStream::WriteInfo::~WriteInfo() {
+  blockIds.clear();
+  buffer.clear();
+}
 
 void FileStream::Close() {
-  if (mode == Mode::WRITE)
-    Flush();
+  if (mode == Mode::WRITE) {
+    // the data is always made durable on close, whatever the flush policy,
+    // except for the parts which are committed together
+    if (storageType == BLOB && writeInfo.bPartWriter)
+      StagePendingBlocks();
+    else if (storageType == BLOB)
+      CommitBlob(true);
+    else
+      Flush();
+  }
 }
 
 size_t FileStream::Read(void *dest, size_t nSize, size_t nCount) {
@@ -132,37 +235,7 @@ size_t FileStream::Read(void *dest, size_t nSize, size_t nCount) {
         (int64_t)(nToRead < fragment.nContentSize ? nToRead
                                                   : fragment.nContentSize)};
 
-    unique_ptr<Azure::Core::IO::BodyStream> bodyStream;
-
-    try {
-      if (fragment.client.tag == BLOB) {
-        Azure::Storage::Blobs::BlobAccessConditions accessConditions;
-        accessConditions.IfMatch = fragment.etag;
-        Azure::Storage::Blobs::DownloadBlobOptions opts;
-        opts.AccessConditions = accessConditions;
-        opts.Range = range;
-        auto downloadResult =
-            std::move(fragment.client.blob.Download(opts).Value);
-        bodyStream = std::move(downloadResult.BodyStream);
-      } else // SHARE storage
-      {
-        Azure::Storage::Files::Shares::DownloadFileOptions opts;
-        opts.Range = range;
-        auto downloadResult =
-            std::move(fragment.client.shareFile.Download(opts).Value);
-        if (downloadResult.Details.ETag != fragment.etag)
-          throw ReadingUpdatedFileError();
-        bodyStream = std::move(downloadResult.BodyStream);
-      }
-    } catch (const Azure::Storage::StorageException &exc) {
-      if (exc.StatusCode ==
-          Azure::Core::Http::HttpStatusCode::RangeNotSatisfiable)
-        throw ReadAtEOFError();
-      if (exc.StatusCode ==
-          Azure::Core::Http::HttpStatusCode::PreconditionFailed)
-        throw ReadingUpdatedFileError();
-      throw;
-    }
+    auto bodyStream = DownloadFragmentRange(fragment, range);
     nRead = bodyStream->ReadToCount((uint8_t *)dest, nToRead);
     
     if (nToRead > 0 && nRead == 0) {
@@ -182,6 +255,85 @@ size_t FileStream::Read(void *dest, size_t nSize, size_t nCount) {
   return nTotalRead;
 }
 
+size_t FileStream::ReadAt(size_t nOffset, void *dest, size_t nToRead) const {
+  if (mode != Mode::READ)
+    throw InvalidOperationForStreamModeError("read", mode);
+
+  size_t nTotalFileSize = readInfo.GetSize();
+  nToRead = nOffset < nTotalFileSize ? min(nToRead, nTotalFileSize - nOffset)
+                                     : 0;
+  size_t nTotalRead = 0;
+  while (nTotalRead < nToRead) {
+    const FragmentedFile::Fragment &fragment = readInfo.GetFragment(
+        readInfo.GetFragmentIndexOfUserOffset(nOffset));
+    size_t nFragmentOffset = nOffset - fragment.nUserOffset;
+    size_t nRangeSize =
+        min(nToRead - nTotalRead, fragment.nContentSize - nFragmentOffset);
+    // the header of the first fragment is part of the content
+    size_t nHeaderLen =
+        fragment.nUserOffset == 0 ? 0 : readInfo.GetHeaderLen();
+    Azure::Core::Http::HttpRange range{
+        (int64_t)(nHeaderLen + nFragmentOffset), (int64_t)nRangeSize};
+
+    auto bodyStream = DownloadFragmentRange(fragment, range);
+    if (bodyStream->ReadToCount((uint8_t *)dest, nRangeSize) != nRangeSize)
+      throw ReadingUpdatedFileError();
+    nOffset += nRangeSize;
+    nTotalRead += nRangeSize;
+    dest = (uint8_t *)dest + nRangeSize;
+  }
+  return nTotalRead;
+}
+
+unique_ptr<Azure::Core::IO::BodyStream> FileStream::DownloadFragmentRange(
+    const FragmentedFile::Fragment &fragment,
+    const Azure::Core::Http::HttpRange &range) const {
+  try {
+    if (fragment.client.tag == BLOB) {
+      Azure::Storage::Blobs::BlobAccessConditions accessConditions;
+      accessConditions.IfMatch = fragment.etag;
+      Azure::Storage::Blobs::DownloadBlobOptions opts;
+      opts.AccessConditions = accessConditions;
+      opts.Range = range;
+      auto downloadResult =
+          std::move(fragment.client.blob.Download(opts).Value);
+      return std::move(downloadResult.BodyStream);
+    } else // SHARE storage
+    {
+      Azure::Storage::Files::Shares::DownloadFileOptions opts;
+      opts.Range = range;
+      auto downloadResult =
+          std::move(fragment.client.shareFile.Download(opts).Value);
+      if (downloadResult.Details.ETag != fragment.etag)
+        throw ReadingUpdatedFileError();
+      return std::move(downloadResult.BodyStream);
+    }
+  } catch (const Azure::Storage::StorageException &exc) {
+    if (exc.StatusCode ==
+        Azure::Core::Http::HttpStatusCode::RangeNotSatisfiable)
+      throw ReadAtEOFError();
+    if (exc.StatusCode ==
+        Azure::Core::Http::HttpStatusCode::PreconditionFailed)
+      throw ReadingUpdatedFileError();
+    throw;
+  }
+}
+
+size_t FileStream::GetSize() const {
+  if (mode != Mode::READ)
+    throw InvalidOperationForStreamModeError("get the size of", mode);
+  return readInfo.GetSize();
+}
+
+string FileStream::GetVersion() const {
+  if (mode != Mode::READ)
+    throw InvalidOperationForStreamModeError("get the version of", mode);
+  string sVersion;
+  for (size_t i = 0; i != readInfo.GetFragmentCount(); i++)
+    sVersion += readInfo.GetFragment(i).etag.ToString() + ",";
+  return sVersion;
+}
+
 void FileStream::Seek(long long int nOffset, int nOrigin) {
   if (mode != Mode::READ)
     throw InvalidOperationForStreamModeError("seek", mode);
@@ -214,54 +366,404 @@ size_t FileStream::Write(const void *source, size_t nSize, size_t nCount) {
   if (mode != Mode::WRITE)
     throw InvalidOperationForStreamModeError("write", mode);
 
-  if (storageType == BLOB) {
-    Azure::Storage::Blobs::BlockBlobClient bbclient =
-        writeInfo.client.blob.AsBlockBlobClient();
+  size_t nToWrite = nSize * nCount;
+  if (writeInfo.partClients)
+    WriteShards((const uint8_t *)source, nToWrite);
+  else
+    WriteObject((const uint8_t *)source, nToWrite);
+  return nToWrite;
+}
 
-    size_t nToWrite = nSize * nCount;
+void FileStream::WriteObject(const uint8_t *data, size_t nToWrite) {
+  size_t nLeft = nToWrite;
 
-    string sBlockIdInBase10 = (ostringstream() << setfill('0') << setw(64)
-                                               << writeInfo.blockIds.size())
-                                  .str();
-    vector<uint8_t> blockIdInBase10(sBlockIdInBase10.begin(),
-                                    sBlockIdInBase10.end());
-    string sBlockIdInBase64 =
-        Azure::Core::Convert::Base64Encode(blockIdInBase10);
+  if (storageType == BLOB) {
+    if (writeInfo.bAppendBlob) {
+      while (nLeft > 0) {
+        size_t nCopied =
+            min(nLeft, nMaxAppendBlockSize - writeInfo.buffer.size());
+        writeInfo.buffer.insert(writeInfo.buffer.end(), data, data + nCopied);
+        data += nCopied;
+        nLeft -= nCopied;
+        if (writeInfo.buffer.size() == nMaxAppendBlockSize)
+          AppendBlock();
+      }
+      writeInfo.nUncommittedSize += nToWrite;
+      return;
+    }
 
-    Azure::Core::IO::MemoryBodyStream bodyStream((const uint8_t *)source,
-                                                 nToWrite);
-    bbclient.StageBlock(sBlockIdInBase64, bodyStream);
-    writeInfo.blockIds.push_back(sBlockIdInBase64);
+    // Complete the pending block first, then stage full blocks from the
+    // caller's data and keep the remainder for the next writes. The blocks
+    // staged in the background are copied, as the caller's data may not
+    // outlive the call, but they are staged in place when not pipelined.
+    if (!writeInfo.buffer.empty()) {
+      size_t nCopied =
+          min(nLeft, writeInfo.nBlockSize - writeInfo.buffer.size());
+      writeInfo.buffer.insert(writeInfo.buffer.end(), data, data + nCopied);
+      data += nCopied;
+      nLeft -= nCopied;
+      if (writeInfo.buffer.size() == writeInfo.nBlockSize) {
+        StageBlock(std::move(writeInfo.buffer));
+        writeInfo.buffer.clear();
+      }
+    }
+    while (nLeft >= writeInfo.nBlockSize) {
+      size_t nBlockSize = writeInfo.nBlockSize;
+      if (writeInfo.config->nWriteConcurrency <= 1)
+        StageBlockInPlace(data, nBlockSize);
+      else
+        StageBlock(vector<uint8_t>(data, data + nBlockSize));
+      data += nBlockSize;
+      nLeft -= nBlockSize;
+    }
+    writeInfo.buffer.insert(writeInfo.buffer.end(), data, data + nLeft);
 
-    return nToWrite;
+    writeInfo.nUncommittedSize += nToWrite;
   } else // SHARE storage
   {
-    Azure::Storage::Files::Shares::Models::FileHttpHeaders httpHeaders;
-    Azure::Storage::Files::Shares::Models::FileSmbProperties smbProperties;
-    Azure::Storage::Files::Shares::SetFilePropertiesOptions opts;
+    while (nLeft > 0) {
+      size_t nCopied = min(nLeft, nMaxRangeSize - writeInfo.buffer.size());
+      writeInfo.buffer.insert(writeInfo.buffer.end(), data, data + nCopied);
+      data += nCopied;
+      nLeft -= nCopied;
+      if (writeInfo.buffer.size() == nMaxRangeSize)
+        UploadRange();
+    }
+    nCurrentPos += nToWrite;
+  }
+}
 
-    size_t nToWrite = nSize * nCount;
+void FileStream::WriteShards(const uint8_t *data, size_t nToWrite) {
+  size_t nLeft = nToWrite;
+  if (nLeft == 0)
+    return;
+
+  // The first line is the header repeated at the start of each part
+  if (!writeInfo.bHeaderComplete) {
+    const uint8_t *eol = (const uint8_t *)memchr(data, '\n', nLeft);
+    const uint8_t *headerEnd = eol ? eol + 1 : data + nLeft;
+    writeInfo.sHeader.append(data, headerEnd);
+    writeInfo.bHeaderComplete = eol != nullptr;
+  }
 
-    Azure::Core::IO::MemoryBodyStream bodyStream((const uint8_t *)source,
-                                                 nToWrite);
-    opts.Size = nCurrentPos + nToWrite;
-    writeInfo.client.shareFile.SetProperties(httpHeaders, smbProperties, opts);
-    writeInfo.client.shareFile.UploadRange((int64_t)nCurrentPos, bodyStream);
-    nCurrentPos += nToWrite;
+  while (nLeft > 0) {
+    // The next part is only started once there is data to write to it, so
+    // that no part holds only the header
+    if (writeInfo.bPartFull)
+      StartNextPart();
+
+    size_t nShardSize = writeInfo.config->nShardSize;
+    if (writeInfo.nPartSize < nShardSize || !writeInfo.bHeaderComplete ||
+        writeInfo.nPart + 1 == nMaxShardCount) {
+      size_t nWritten = writeInfo.nPartSize < nShardSize
+                            ? min(nLeft, nShardSize - writeInfo.nPartSize)
+                            : nLeft;
+      WriteObject(data, nWritten);
+      data += nWritten;
+      nLeft -= nWritten;
+      writeInfo.nPartSize += nWritten;
+      continue;
+    }
 
-    return nToWrite;
+    // The part is full, it ends with the current line
+    const uint8_t *eol = (const uint8_t *)memchr(data, '\n', nLeft);
+    size_t nWritten = eol ? (size_t)(eol - data) + 1 : nLeft;
+    WriteObject(data, nWritten);
+    data += nWritten;
+    nLeft -= nWritten;
+    writeInfo.nPartSize += nWritten;
+    writeInfo.bPartFull = eol != nullptr;
   }
 }
 
+void FileStream::StartNextPart() {
+  if (storageType == BLOB)
+    CommitBlob(true);
+  else
+    SyncShareFile();
+
+  writeInfo.client = writeInfo.partClients(++writeInfo.nPart);
+  writeInfo.blockIds.clear();
+  writeInfo.buffer.clear();
+  writeInfo.sBufferBlockId.clear();
+  writeInfo.nBlockSize =
+      min(max(writeInfo.config->nWriteBlockSize, (size_t)1), nMaxBlockSize);
+  writeInfo.nNextBlockIndex = 0;
+  writeInfo.bCommitted = false;
+  writeInfo.nUncommittedSize = 0;
+  writeInfo.nBufferOffset = 0;
+  writeInfo.nAllocatedSize = 0;
+  writeInfo.bShareFileCreated = false;
+  nCurrentPos = 0;
+  if (storageType == SHARE)
+    ResizeShareFile(0);
+
+  writeInfo.nPartSize = 0;
+  writeInfo.bPartFull = false;
+  WriteObject((const uint8_t *)writeInfo.sHeader.data(),
+              writeInfo.sHeader.size());
+  writeInfo.nPartSize = writeInfo.sHeader.size();
+}
+
 void FileStream::Flush() {
   if (mode != Mode::WRITE)
     throw InvalidOperationForStreamModeError("flush", mode);
 
-  if (storageType == BLOB) {
+  if (storageType == BLOB && writeInfo.bPartWriter) {
+    // the part is only visible once committed with the others
+  } else if (storageType == BLOB) {
+    switch (writeInfo.config->flushPolicy) {
+    case FlushPolicy::ALWAYS:
+      CommitBlob(false);
+      break;
+    case FlushPolicy::CHANGED:
+      // the first commit creates the blob, even if nothing was written
+      if (!writeInfo.bCommitted ||
+          (writeInfo.nUncommittedSize > 0 &&
+           writeInfo.nUncommittedSize >= writeInfo.config->nMinFlushSize))
+        CommitBlob(false);
+      break;
+    case FlushPolicy::CLOSE:
+      break;
+    }
+  } else {
+    SyncShareFile();
+    writeInfo.client.shareFile.ForceCloseAllHandles();
+  }
+}
+
+void FileStream::StageBlock(vector<uint8_t> &&block) {
+  // the buffered data may have been staged partially by a commit
+  string sBlockId = writeInfo.sBufferBlockId.empty()
+                        ? MakeNextBlockId()
+                        : std::move(writeInfo.sBufferBlockId);
+  writeInfo.sBufferBlockId.clear();
+  auto client = writeInfo.client.blob.AsBlockBlobClient();
+  // std::function requires copyable tasks, hence the shared block
+  auto sharedBlock = make_shared<vector<uint8_t>>(std::move(block));
+  writeInfo.uploads->Submit([client, sBlockId, sharedBlock]() {
+    Azure::Core::IO::MemoryBodyStream bodyStream(sharedBlock->data(),
+                                                 sharedBlock->size());
+    client.StageBlock(sBlockId, bodyStream);
+  });
+  AddBlockId(sBlockId);
+}
+
+void FileStream::StageBlockInPlace(const uint8_t *data, size_t nSize) {
+  string sBlockId = MakeNextBlockId();
+  Azure::Core::IO::MemoryBodyStream bodyStream(data, nSize);
+  writeInfo.client.blob.AsBlockBlobClient().StageBlock(sBlockId, bodyStream);
+  AddBlockId(sBlockId);
+}
+
+string FileStream::MakeNextBlockId() {
+  if (writeInfo.blockIds.size() == nMaxBlockCount)
+    throw TooManyBlocksError(nMaxBlockCount);
+
+  return writeInfo.bPartWriter
+             ? MakePartBlockId(writeInfo.nPart, writeInfo.nAttempt,
+                               writeInfo.nNextBlockIndex++)
+             : MakeBlockId(writeInfo.nNextBlockIndex++);
+}
+
+void FileStream::AddBlockId(const string &sBlockId) {
+  writeInfo.blockIds.push_back(sBlockId);
+  if (writeInfo.blockIds.size() % nBlockSizeGrowthPeriod == 0)
+    writeInfo.nBlockSize = min(2 * writeInfo.nBlockSize, nMaxBlockSize);
+}
+
+void FileStream::CompactBlocks(
+    const vector<Azure::Storage::Blobs::Models::BlobBlock> &blocks,
+    const Azure::ETag &etag,
+    const CopySourceAuthorization &copySourceAuthorization) {
+  auto client = writeInfo.client.blob.AsBlockBlobClient();
+  string sSourceUrl = copySourceAuthorization.GetSourceUrl(client.GetUrl());
+  vector<string> compactedBlockIds;
+
+  // Runs of consecutive blocks are merged by the service into blocks of the
+  // largest size it can stage from a range of the blob itself. A blob made of
+  // large blocks may not have enough of them to merge, and would be copied
+  // again at each opening for little gain.
+  struct BlockRun {
+    size_t nFirstBlock;
+    size_t nBlockCount;
+    size_t nOffset;
+    size_t nSize;
+  };
+  vector<BlockRun> runs;
+  size_t nOffset = 0;
+  size_t i = 0;
+  while (i < blocks.size()) {
+    size_t j = i + 1;
+    size_t nRunSize = (size_t)blocks[i].Size;
+    while (j < blocks.size() &&
+           nRunSize + (size_t)blocks[j].Size <= nMaxBlockFromUriSize) {
+      nRunSize += (size_t)blocks[j].Size;
+      j++;
+    }
+    runs.push_back(BlockRun{i, j - i, nOffset, nRunSize});
+    nOffset += nRunSize;
+    i = j;
+  }
+  if (runs.size() > blocks.size() / 2)
+    return;
+
+  try {
+    for (const auto &run : runs) {
+      if (run.nBlockCount == 1) {
+        compactedBlockIds.push_back(blocks[run.nFirstBlock].Name);
+      } else {
+        string sBlockId = MakeBlockId(writeInfo.nNextBlockIndex++);
+        Azure::Storage::Blobs::StageBlockFromUriOptions opts;
+        opts.SourceRange = Azure::Core::Http::HttpRange{(int64_t)run.nOffset,
+                                                        (int64_t)run.nSize};
+        opts.SourceAccessConditions.IfMatch = etag;
+        if (!copySourceAuthorization.sAuthorization.empty())
+          opts.SourceAuthorization = copySourceAuthorization.sAuthorization;
+        writeInfo.uploads->Submit([client, sBlockId, sSourceUrl, opts]() {
+          client.StageBlockFromUri(sBlockId, sSourceUrl, opts);
+        });
+        compactedBlockIds.push_back(sBlockId);
+      }
+    }
+    writeInfo.uploads->Wait();
+
+    Azure::Storage::Blobs::CommitBlockListOptions commitOpts;
+    commitOpts.AccessConditions.IfMatch = etag;
+    client.CommitBlockList(compactedBlockIds, commitOpts);
+    writeInfo.blockIds = compactedBlockIds;
+  } catch (const exception &exc) {
+    // The blob is left as is, the service discarding the blocks staged for
+    // nothing, so the writer can go on appending to it
+    try {
+      writeInfo.uploads->Wait();
+    } catch (const exception &) {
+    }
+    spdlog::warn("Compaction of {} failed: {}", client.GetUrl(), exc.what());
+  }
+}
+
+void FileStream::StageExistingContent(
+    size_t nBlobSize, const Azure::ETag &etag,
+    const CopySourceAuthorization &copySourceAuthorization) {
+  auto client = writeInfo.client.blob.AsBlockBlobClient();
+  string sSourceUrl = copySourceAuthorization.GetSourceUrl(client.GetUrl());
+  for (size_t nOffset = 0; nOffset < nBlobSize;
+       nOffset += nMaxBlockFromUriSize) {
+    size_t nRangeSize = min(nBlobSize - nOffset, nMaxBlockFromUriSize);
+    string sBlockId = MakeNextBlockId();
+    Azure::Storage::Blobs::StageBlockFromUriOptions opts;
+    opts.SourceRange =
+        Azure::Core::Http::HttpRange{(int64_t)nOffset, (int64_t)nRangeSize};
+    opts.SourceAccessConditions.IfMatch = etag;
+    if (!copySourceAuthorization.sAuthorization.empty())
+      opts.SourceAuthorization = copySourceAuthorization.sAuthorization;
+    writeInfo.uploads->Submit([client, sBlockId, sSourceUrl, opts]() {
+      client.StageBlockFromUri(sBlockId, sSourceUrl, opts);
+    });
+    AddBlockId(sBlockId);
+  }
+  // the blob cannot be appended to if its content could not be staged
+  writeInfo.uploads->Wait();
+}
+
+void FileStream::AppendBlock() {
+  // The blocks are appended in order, hence synchronously
+  Azure::Core::IO::MemoryBodyStream bodyStream(writeInfo.buffer.data(),
+                                               writeInfo.buffer.size());
+  writeInfo.client.blob.AsAppendBlobClient().AppendBlock(bodyStream);
+  writeInfo.buffer.clear();
+}
+
+void FileStream::CommitBlob(bool bClosing) {
+  if (writeInfo.bAppendBlob) {
+    if (!writeInfo.buffer.empty())
+      AppendBlock();
+  } else if (bClosing && writeInfo.blockIds.empty()) {
+    // a blob uploaded in one request has no blocks to append to, so this is
+    // only done once the writer does not need them anymore
+    Azure::Core::IO::MemoryBodyStream bodyStream(writeInfo.buffer.data(),
+                                                 writeInfo.buffer.size());
+    writeInfo.client.blob.AsBlockBlobClient().Upload(bodyStream);
+    writeInfo.buffer.clear();
+  } else if (bClosing) {
+    StagePendingBlocks();
     writeInfo.client.blob.AsBlockBlobClient().CommitBlockList(
         writeInfo.blockIds);
   } else {
-    writeInfo.client.shareFile.ForceCloseAllHandles();
+    StagePartialBlock();
+    vector<string> blockIds = writeInfo.blockIds;
+    if (!writeInfo.sBufferBlockId.empty())
+      blockIds.push_back(writeInfo.sBufferBlockId);
+    writeInfo.client.blob.AsBlockBlobClient().CommitBlockList(blockIds);
   }
+  writeInfo.bCommitted = true;
+  writeInfo.nUncommittedSize = 0;
+}
+
+void FileStream::StagePendingBlocks() {
+  if (!writeInfo.buffer.empty()) {
+    StageBlock(std::move(writeInfo.buffer));
+    writeInfo.buffer.clear();
+  }
+  writeInfo.uploads->Wait();
+}
+
+void FileStream::StagePartialBlock() {
+  writeInfo.uploads->Wait();
+  if (writeInfo.buffer.empty())
+    return;
+  if (writeInfo.sBufferBlockId.empty())
+    writeInfo.sBufferBlockId = MakeNextBlockId();
+  Azure::Core::IO::MemoryBodyStream bodyStream(writeInfo.buffer.data(),
+                                               writeInfo.buffer.size());
+  writeInfo.client.blob.AsBlockBlobClient().StageBlock(
+      writeInfo.sBufferBlockId, bodyStream);
+}
+
+void FileStream::UploadRange() {
+  size_t nEnd = writeInfo.nBufferOffset + writeInfo.buffer.size();
+  if (nEnd > writeInfo.nAllocatedSize) {
+    size_t nGrowth = min(max(writeInfo.nAllocatedSize, nMaxRangeSize),
+                         nMaxShareFileGrowth);
+    ResizeShareFile(max(nEnd, writeInfo.nAllocatedSize + nGrowth));
+  }
+
+  auto client = writeInfo.client.shareFile;
+  int64_t nOffset = (int64_t)writeInfo.nBufferOffset;
+  // std::function requires copyable tasks, hence the shared range
+  auto sharedRange = make_shared<vector<uint8_t>>(std::move(writeInfo.buffer));
+  writeInfo.buffer.clear();
+  writeInfo.uploads->Submit([client, nOffset, sharedRange]() {
+    Azure::Core::IO::MemoryBodyStream bodyStream(sharedRange->data(),
+                                                 sharedRange->size());
+    client.UploadRange(nOffset, bodyStream);
+  });
+  writeInfo.nBufferOffset = nEnd;
+}
+
+void FileStream::ResizeShareFile(size_t nSize) {
+  if (!writeInfo.bShareFileCreated) {
+    writeInfo.client.shareFile.Create((int64_t)nSize);
+    writeInfo.bShareFileCreated = true;
+    writeInfo.nAllocatedSize = nSize;
+    return;
+  }
+  Azure::Storage::Files::Shares::Models::FileHttpHeaders httpHeaders;
+  Azure::Storage::Files::Shares::Models::FileSmbProperties smbProperties;
+  Azure::Storage::Files::Shares::SetFilePropertiesOptions opts;
+  opts.Size = (int64_t)nSize;
+  writeInfo.client.shareFile.SetProperties(httpHeaders, smbProperties, opts);
+  writeInfo.nAllocatedSize = nSize;
+}
+
+void FileStream::SyncShareFile() {
+  if (!writeInfo.bShareFileCreated)
+    ResizeShareFile(nCurrentPos);
+  if (!writeInfo.buffer.empty())
+    UploadRange();
+  writeInfo.uploads->Wait();
+  if (writeInfo.nAllocatedSize != nCurrentPos)
+    ResizeShareFile(nCurrentPos);
 }
 } // namespace az
@@ -3,14 +3,19 @@
 
 #pragma once
 
+#include "config.hpp"
+#include "copysource.hpp"
 #include "exception.hpp"
-#include "filestream.hpp"
 #include "fragmentedfile.hpp"
 #include "objectclient.hpp"
 #include "storagetype.hpp"
+#include "taskgroup.hpp"
 #include <azure/storage/blobs/blob_client.hpp>
 #include <azure/storage/files/shares/share_file_client.hpp>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -27,13 +32,39 @@ public:
       const std::vector<Azure::Storage::Files::Shares::ShareFileClient>
           &clients);
   static FileStream OpenForReading(const std::vector<ObjectClient> &clients);
+  // Blobs opened for appending are compacted when too fragmented, the copy
+  // source authorization being used by the service to read the blob itself
   static FileStream
   OpenForWriting(OutputMode mode,
-                 const Azure::Storage::Blobs::BlobClient &client);
+                 const Azure::Storage::Blobs::BlobClient &client,
+                 const std::shared_ptr<const Config> &config,
+                 const CopySourceAuthorization &copySourceAuthorization);
   static FileStream
   OpenForWriting(OutputMode mode,
-                 const Azure::Storage::Files::Shares::ShareFileClient &client);
-  static FileStream OpenForWriting(OutputMode mode, const ObjectClient &client);
+                 const Azure::Storage::Files::Shares::ShareFileClient &client,
+                 const std::shared_ptr<const Config> &config);
+  static FileStream
+  OpenForWriting(OutputMode mode, const ObjectClient &client,
+                 const std::shared_ptr<const Config> &config,
+                 const CopySourceAuthorization &copySourceAuthorization);
+  // Sharded files have at most as many parts as two-digit part numbers, so
+  // that listing them in lexicographic order keeps them in order
+  static constexpr size_t nMaxShardCount = 100;
+  // Writes one logical file as a sequence of parts, whose clients are given
+  // by their index. A part is rotated at the end of the line during which it
+  // reaches the shard size, and all parts start with the first line written,
+  // which readers of the parts as a fragmented file skip as a header. The
+  // parts are written one after the other, each of them by blocks or ranges
+  // uploaded concurrently, and can then be processed in parallel.
+  static FileStream OpenForShardedWriting(
+      const std::function<ObjectClient(size_t nPart)> &partClients,
+      const std::shared_ptr<const Config> &config);
+  // Writes one part of a blob written by several writers, possibly from
+  // different processes. The part is staged on close, and only becomes part
+  // of the blob once committed with the others by Driver::CommitParts.
+  static FileStream
+  OpenPartForWriting(const Azure::Storage::Blobs::BlobClient &client,
+                     const std::shared_ptr<const Config> &config, size_t nPart);
   FileStream(FileStream &&source);
   ~FileStream();
 
@@ -44,6 +75,12 @@ public:
   // Reader-only operations
   size_t Read(void *dest, size_t nSize, size_t nCount);
   void Seek(long long int nOffset, int nOrigin);
+  size_t GetSize() const;
+  // Changes whenever one of the fragments of the file is updated
+  std::string GetVersion() const;
+  // Reads the nToRead bytes at nOffset, or up to the end of the file, without
+  // using the current position, so that ranges can be read concurrently
+  size_t ReadAt(size_t nOffset, void *dest, size_t nToRead) const;
 
   // Writer-only operations
   size_t Write(const void *source, size_t nSize, size_t nCount);
@@ -58,12 +95,92 @@ private:
   Mode mode;
   size_t nCurrentPos;
 
+  // Downloads a range of a fragment, failing if the fragment was updated
+  // since the file was opened
+  std::unique_ptr<Azure::Core::IO::BodyStream>
+  DownloadFragmentRange(const FragmentedFile::Fragment &fragment,
+                        const Azure::Core::Http::HttpRange &range) const;
+
+  void WriteObject(const uint8_t *data, size_t nToWrite);
+  void WriteShards(const uint8_t *data, size_t nToWrite);
+  // Makes the current part durable and starts writing the next one
+  void StartNextPart();
+
+  // Blob writers buffer the written data and stage it in blocks of
+  // nBlockSize bytes, which grows as the blob does so that the block count
+  // stays below the service limit. The blocks are staged in the background,
+  // their IDs being recorded in submission order.
+  void StageBlock(std::vector<uint8_t> &&block);
+  // Stages a block synchronously from data owned by the caller, which is only
+  // possible when the blocks are not staged in the background
+  void StageBlockInPlace(const uint8_t *data, size_t nSize);
+  // ID of the next block to stage, recorded by AddBlockId only once the block
+  // is staged or its staging is accepted, so that the list to commit never
+  // names a block which failed to be submitted
+  std::string MakeNextBlockId();
+  // Records the ID of a staged block and grows the block size
+  void AddBlockId(const std::string &sBlockId);
+  // Stages the content of a blob which has no blocks as blocks staged by the
+  // service from ranges of the blob itself, for the next commit to keep it
+  void StageExistingContent(
+      size_t nBlobSize, const Azure::ETag &etag,
+      const CopySourceAuthorization &copySourceAuthorization);
+  // Merges runs of small committed blocks into large blocks staged by the
+  // service from the blob itself, and commits them if this at least halves the
+  // number of blocks. Failures are ignored.
+  void CompactBlocks(
+      const std::vector<Azure::Storage::Blobs::Models::BlobBlock> &blocks,
+      const Azure::ETag &etag,
+      const CopySourceAuthorization &copySourceAuthorization);
+  // In append mode, blob writers may instead append blocks of buffered data
+  // to an append blob, without any block list to maintain
+  void AppendBlock();
+  // Makes the data written to a blob durable: stages the pending data and
+  // commits all the blocks, or appends the pending data. When closing a blob
+  // whose data all fits in the buffer, it is uploaded in a single request.
+  void CommitBlob(bool bClosing);
+  // Stages the buffered data and waits for all the staged blocks
+  void StagePendingBlocks();
+  // Waits for the staged blocks and stages the buffered data without emptying
+  // the buffer, so that a commit does not leave a small block behind: the
+  // complete block is staged again later under the same ID
+  void StagePartialBlock();
+  // Share writers buffer the written data and upload it in the background in
+  // ranges of the maximal size. The file is created empty when opened, grown
+  // geometrically ahead of the uploads, and trimmed to the written size when
+  // flushed.
+  void UploadRange();
+  void ResizeShareFile(size_t nSize);
+  void SyncShareFile();
+
   struct WriteInfo {
     OutputMode mode;
     ObjectClient client;
+    std::shared_ptr<const Config> config;
+    bool bAppendBlob;
     std::vector<std::string> blockIds;
+    std::vector<uint8_t> buffer;
+    std::string sBufferBlockId; // ID of the buffered data once staged partially
+    size_t nBlockSize;
+    std::unique_ptr<TaskGroup> uploads;
+    size_t nNextBlockIndex;
+    bool bCommitted;
+    size_t nUncommittedSize; // bytes written since the last commit
+    size_t nBufferOffset;    // offset in the share file of the buffered data
+    size_t nAllocatedSize;   // current size of the share file
+    bool bShareFileCreated;
+    // Sharded writers only
+    std::function<ObjectClient(size_t nPart)> partClients;
+    size_t nPart; // also the part of part writers
+    size_t nPartSize;
+    std::string sHeader;
+    bool bHeaderComplete;
+    bool bPartFull; // the next data written goes to the next part
+    // Part writers only
+    bool bPartWriter;
+    uint64_t nAttempt; // distinguishes the blocks of successive openings
     WriteInfo(OutputMode mode, const ObjectClient &client,
-              const std::vector<std::string> &blockIds);
+              const std::shared_ptr<const Config> &config);
     WriteInfo(WriteInfo &&source);
     ~WriteInfo();
   };
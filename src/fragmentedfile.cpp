@@ -144,6 +144,8 @@ size_t FragmentedFile::GetSize() const { return nSize; }
 
 size_t FragmentedFile::GetHeaderLen() const { return nHeaderLen; }
 
+size_t FragmentedFile::GetFragmentCount() const { return fragments.size(); }
+
 const FragmentedFile::Fragment &
 FragmentedFile::GetFragment(size_t nIndex) const {
   return fragments.at(nIndex);
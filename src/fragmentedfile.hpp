@@ -43,6 +43,8 @@ public:
   ~FragmentedFile();
   size_t GetSize() const;
   size_t GetHeaderLen() const;
+  // Fragments with no content besides the header are not counted
+  size_t GetFragmentCount() const;
   const Fragment &GetFragment(size_t nIndex) const;
   size_t GetFragmentIndexOfUserOffset(size_t nUserOffset) const;
 
@@ -0,0 +1,64 @@
+// Thread-safe cache with a bounded number of entries, evicting the least
+// recently used entry when full.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace az {
+template <typename K, typename V> class LruCache {
+public:
+  explicit LruCache(size_t nCapacity) : nCapacity(nCapacity) {}
+
+  // Copies the value cached for key to value and returns true, or returns
+  // false if key is not in the cache
+  bool Find(const K &key, V &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end())
+      return false;
+    entries.splice(entries.begin(), entries, it->second);
+    value = it->second->second;
+    return true;
+  }
+
+  void Insert(const K &key, const V &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nCapacity == 0)
+      return;
+    auto it = index.find(key);
+    if (it != index.end()) {
+      it->second->second = value;
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+    if (entries.size() == nCapacity) {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+    entries.emplace_front(key, value);
+    index[key] = entries.begin();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    index.clear();
+    entries.clear();
+  }
+
+  size_t GetSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+private:
+  size_t nCapacity;
+  mutable std::mutex mutex;
+  std::list<std::pair<K, V>> entries; // most recently used first
+  std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index;
+};
+} // namespace az
@@ -31,4 +31,7 @@ ObjectClient &ObjectClient::operator=(const ObjectClient &source) {
     shareFile = source.shareFile;
   return *this;
 }
+std::string ObjectClient::GetUrl() const {
+  return tag == BLOB ? blob.GetUrl() : shareFile.GetUrl();
+}
 } // namespace az
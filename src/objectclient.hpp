@@ -6,6 +6,7 @@
 #include "storagetype.hpp"
 #include <azure/storage/blobs/blob_client.hpp>
 #include <azure/storage/files/shares/share_file_client.hpp>
+#include <string>
 
 namespace az {
 struct ObjectClient {
@@ -19,5 +20,6 @@ struct ObjectClient {
   ObjectClient(const Azure::Storage::Files::Shares::ShareFileClient &client);
   ~ObjectClient();
   ObjectClient &operator=(const ObjectClient &source);
+  std::string GetUrl() const;
 };
 } // namespace az
@@ -0,0 +1,22 @@
+// Limits of the storage services, for all the service versions used by the
+// driver.
+
+#pragma once
+
+#include <cstddef>
+
+namespace az {
+// Block blobs
+static constexpr size_t nMaxBlockCount = 50000;
+static constexpr size_t nMaxBlockSize = 4000ULL * 1024 * 1024;
+// Blocks staged from a range of a blob
+static constexpr size_t nMaxBlockFromUriSize = 100 * 1024 * 1024;
+// Blobs copied from a URL in a single request
+static constexpr size_t nMaxCopyFromUriSize = 256 * 1024 * 1024;
+// Append blob blocks
+static constexpr size_t nMaxAppendBlockSize = 4 * 1024 * 1024;
+// Share file ranges, uploaded or copied from a URL
+static constexpr size_t nMaxRangeSize = 4 * 1024 * 1024;
+// Sub-requests of a blob batch
+static constexpr size_t nMaxBatchSize = 256;
+} // namespace az
@@ -0,0 +1,94 @@
+#include "taskgroup.hpp"
+
+using namespace std;
+
+namespace az {
+TaskGroup::TaskGroup(size_t nMaxConcurrency)
+    : nMaxConcurrency(nMaxConcurrency), nRunningTasks(0), bStopping(false) {}
+
+TaskGroup::~TaskGroup() {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    bStopping = true;
+  }
+  taskAvailable.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void TaskGroup::Submit(function<void()> task) {
+  if (nMaxConcurrency <= 1) {
+    if (firstError)
+      rethrow_exception(firstError);
+    try {
+      task();
+    } catch (...) {
+      firstError = current_exception();
+      throw;
+    }
+    return;
+  }
+
+  unique_lock<std::mutex> lock(mutex);
+  // The workers are started lazily, so that short-lived groups do not pay for
+  // threads they do not use
+  if (workers.size() < nMaxConcurrency &&
+      nRunningTasks + pendingTasks.size() >= workers.size()) {
+    workers.emplace_back(&TaskGroup::RunWorker, this);
+  }
+  taskDone.wait(lock, [this]() {
+    return firstError ||
+           nRunningTasks + pendingTasks.size() < nMaxConcurrency;
+  });
+  if (firstError)
+    rethrow_exception(firstError);
+  pendingTasks.push_back(std::move(task));
+  lock.unlock();
+  taskAvailable.notify_one();
+}
+
+void TaskGroup::Wait() {
+  unique_lock<std::mutex> lock(mutex);
+  taskDone.wait(lock, [this]() {
+    return nRunningTasks == 0 && pendingTasks.empty();
+  });
+  lock.unlock();
+  RethrowError();
+}
+
+void TaskGroup::RunWorker() {
+  unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    taskAvailable.wait(
+        lock, [this]() { return bStopping || !pendingTasks.empty(); });
+    if (pendingTasks.empty())
+      return; // stopping
+    auto task = std::move(pendingTasks.front());
+    pendingTasks.pop_front();
+    // tasks submitted after an error are dropped
+    if (!firstError) {
+      nRunningTasks++;
+      lock.unlock();
+      try {
+        task();
+        lock.lock();
+      } catch (...) {
+        lock.lock();
+        if (!firstError)
+          firstError = current_exception();
+      }
+      nRunningTasks--;
+    }
+    taskDone.notify_all();
+  }
+}
+
+void TaskGroup::RethrowError() {
+  lock_guard<std::mutex> lock(mutex);
+  if (firstError) {
+    auto error = firstError;
+    firstError = nullptr;
+    rethrow_exception(error);
+  }
+}
+} // namespace az
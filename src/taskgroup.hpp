@@ -0,0 +1,49 @@
+// Group of tasks run concurrently by a bounded set of worker threads. Callers
+// submitting more tasks than there are workers are blocked until one of them is
+// available, and the first error raised by a task is reported to them.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace az {
+class TaskGroup {
+public:
+  // With a concurrency of 0 or 1, the tasks are run by the submitting thread
+  explicit TaskGroup(size_t nMaxConcurrency);
+  // Waits for the submitted tasks, ignoring their errors
+  ~TaskGroup();
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  // Runs the task once a worker is available. Rethrows the error of a
+  // previous task if there is one, in which case the task is not run
+  void Submit(std::function<void()> task);
+  // Waits for all the submitted tasks and rethrows the first error raised by
+  // them, if any. The group can be used again afterwards
+  void Wait();
+
+private:
+  void RunWorker();
+  void RethrowError();
+
+  size_t nMaxConcurrency;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable taskAvailable;
+  std::condition_variable taskDone;
+  std::deque<std::function<void()>> pendingTasks;
+  size_t nRunningTasks;
+  std::exception_ptr firstError;
+  bool bStopping;
+};
+} // namespace az
@@ -1,6 +1,8 @@
 #define _CRT_SECURE_NO_WARNINGS // getenv would be more secure in C++ than in C
                                 // and getenv_s in not available in C++?
 #include "util.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstdlib>
 #include <random>
@@ -8,6 +10,17 @@
 #include <spdlog/spdlog.h>
 #include <sstream>
 #include <unordered_map>
+#ifdef _WIN32
+#define NOMINMAX
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -158,14 +171,215 @@ bool operator==(const ConnectionString &a, const ConnectionString &b) {
 }
 } // namespace connstr
 
+namespace path {
+bool SplitLeadingSegments(const string &sPath, size_t nLeadingSegments,
+                          vector<string> &parts) {
+  parts.clear();
+  size_t nOffset = 0;
+  size_t nDelimPos;
+  for (size_t i = 0; i < nLeadingSegments; i++) {
+    nDelimPos = sPath.find('/', nOffset);
+    if (nDelimPos == string::npos || nDelimPos == nOffset) {
+      return false;
+    }
+    parts.push_back(sPath.substr(nOffset, nDelimPos - nOffset));
+    nOffset = nDelimPos + 1;
+  }
+  if (nOffset == sPath.length()) {
+    return false;
+  }
+  parts.push_back(sPath.substr(nOffset));
+  return true;
+}
+
+bool SplitSegments(const string &sPath, vector<string> &segments) {
+  segments.clear();
+  size_t nPathLen = sPath.length();
+  size_t nOffset = 0;
+  size_t nDelimPos;
+  while (nOffset != nPathLen) {
+    nDelimPos = sPath.find('/', nOffset);
+    if (nDelimPos == nOffset) {
+      return false;
+    }
+    if (nDelimPos == string::npos) {
+      nDelimPos = nPathLen;
+    }
+    segments.push_back(sPath.substr(nOffset, nDelimPos - nOffset));
+    nOffset = nDelimPos == nPathLen ? nPathLen : nDelimPos + 1;
+  }
+  return !segments.empty();
+}
+
+bool IsSafeRelativePath(const string &sPath) {
+  vector<string> segments;
+  if (str::EndsWith(sPath, "/") || !SplitSegments(sPath, segments))
+    return false;
+  for (const auto &sSegment : segments) {
+    if (sSegment == "." || sSegment == ".." ||
+        sSegment.find('\\') != string::npos)
+      return false;
+  }
+  return true;
+}
+} // namespace path
+
+namespace url {
+bool GetStorageType(const string &sHost, StorageType &storageType) {
+  if (str::EndsWith(sHost, ".blob.core.windows.net"))
+    storageType = BLOB;
+  else if (str::EndsWith(sHost, ".file.core.windows.net"))
+    storageType = SHARE;
+  else
+    return false;
+  return true;
+}
+} // namespace url
+
 namespace glob {
 size_t FindGlobbingChar(const string &str) {
-  smatch match;
-  return regex_search(str, match,
-                      regex("[^\\]([*?![^])", regex_constants::extended))
-             ? match.position(1)
-             : string::npos;
+  // First globbing character not escaped by a backslash. As with the regular
+  // expression used before, a globbing character is only found when it is
+  // preceded by another character.
+  static const string sGlobbingChars = "*?![^";
+  for (size_t i = 1; i < str.length(); i++) {
+    if (sGlobbingChars.find(str[i]) != string::npos && str[i - 1] != '\\') {
+      return i;
+    }
+  }
+  return string::npos;
 }
 } // namespace glob
+
+namespace localfs {
+// Names of the entries of a local directory, with whether they are directories
+static vector<pair<string, bool>> ListDirEntries(const string &sDir) {
+  vector<pair<string, bool>> entries;
+#ifdef _WIN32
+  _finddata_t entry;
+  intptr_t handle = _findfirst((sDir + "/*").c_str(), &entry);
+  if (handle == -1)
+    throw LocalFileError(sDir);
+  do {
+    entries.emplace_back(entry.name, (entry.attrib & _A_SUBDIR) != 0);
+  } while (_findnext(handle, &entry) == 0);
+  _findclose(handle);
+#else
+  DIR *dir = opendir(sDir.c_str());
+  if (!dir)
+    throw LocalFileError(sDir);
+  while (dirent *entry = readdir(dir)) {
+    struct stat entryStat;
+    if (stat((sDir + "/" + entry->d_name).c_str(), &entryStat) == 0)
+      entries.emplace_back(entry->d_name, S_ISDIR(entryStat.st_mode));
+  }
+  closedir(dir);
+#endif
+  return entries;
+}
+
+static void ListFilesRecursively(const string &sDir, const string &sRelDir,
+                                 vector<string> &files) {
+  for (const auto &entry : ListDirEntries(sDir)) {
+    if (entry.first == "." || entry.first == "..")
+      continue;
+    if (entry.second)
+      ListFilesRecursively(sDir + "/" + entry.first,
+                           sRelDir + entry.first + "/", files);
+    else
+      files.push_back(sRelDir + entry.first);
+  }
+}
+
+vector<string> ListFilesRecursively(const string &sDir) {
+  vector<string> files;
+  ListFilesRecursively(sDir, "", files);
+  return files;
+}
+
+void MakeDirs(const string &sDir) {
+  // existing directories are skipped by failing to be created again
+  for (size_t nPos = sDir.find('/', 1);; nPos = sDir.find('/', nPos + 1)) {
+    string sParentDir = sDir.substr(0, nPos);
+#ifdef _WIN32
+    _mkdir(sParentDir.c_str());
+#else
+    mkdir(sParentDir.c_str(), 0777);
+#endif
+    if (nPos == string::npos)
+      break;
+  }
+}
+
+uint64_t GetModificationTime(const string &sPath) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExA(sPath.c_str(), GetFileExInfoStandard, &attributes))
+    throw LocalFileError(sPath);
+  return (uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32 |
+         attributes.ftLastWriteTime.dwLowDateTime;
+#else
+  struct stat fileStat;
+  if (stat(sPath.c_str(), &fileStat) != 0)
+    throw LocalFileError(sPath);
+#ifdef __APPLE__
+  const timespec &modificationTime = fileStat.st_mtimespec;
+#else
+  const timespec &modificationTime = fileStat.st_mtim;
+#endif
+  return (uint64_t)modificationTime.tv_sec * 1000000000 +
+         (uint64_t)modificationTime.tv_nsec;
+#endif
+}
+
+PositionalFile::PositionalFile(const string &sPath) : sPath(sPath) {
+#ifdef _WIN32
+  handle = (intptr_t)CreateFileA(sPath.c_str(), GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if ((HANDLE)handle == INVALID_HANDLE_VALUE)
+    throw LocalFileError(sPath);
+#else
+  handle = open(sPath.c_str(), O_WRONLY);
+  if (handle == -1)
+    throw LocalFileError(sPath);
+#endif
+}
+
+PositionalFile::~PositionalFile() {
+#ifdef _WIN32
+  CloseHandle((HANDLE)handle);
+#else
+  close((int)handle);
+#endif
+}
+
+void PositionalFile::WriteAt(size_t nOffset, const void *source,
+                             size_t nSize) const {
+  const char *data = (const char *)source;
+  while (nSize > 0) {
+#ifdef _WIN32
+    // the offset of an OVERLAPPED structure makes the write positional
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = (DWORD)((uint64_t)nOffset & 0xFFFFFFFF);
+    overlapped.OffsetHigh = (DWORD)((uint64_t)nOffset >> 32);
+    DWORD nWritten;
+    if (!WriteFile((HANDLE)handle, data, (DWORD)min(nSize, (size_t)1 << 30),
+                   &nWritten, &overlapped))
+      throw LocalFileError(sPath);
+#else
+    ssize_t nWritten = pwrite((int)handle, data, nSize, (off_t)nOffset);
+    if (nWritten < 0) {
+      if (errno == EINTR)
+        continue;
+      throw LocalFileError(sPath);
+    }
+#endif
+    data += nWritten;
+    nOffset += (size_t)nWritten;
+    nSize -= (size_t)nWritten;
+  }
+}
+} // namespace localfs
 } // namespace util
 } // namespace az
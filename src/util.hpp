@@ -3,7 +3,9 @@
 #pragma once
 
 #include "exception.hpp"
+#include "storagetype.hpp"
 #include <azure/core/url.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -67,8 +69,62 @@ struct ConnectionString {
 };
 } // namespace connstr
 
+namespace path {
+// Splits the nLeadingSegments first segments of a path, each of them being
+// non-empty and followed by a slash, from the non-empty remainder of the path,
+// which is stored as the last element of parts. Returns false if the path does
+// not follow this pattern.
+bool SplitLeadingSegments(const std::string &sPath, size_t nLeadingSegments,
+                          std::vector<std::string> &parts);
+
+// Splits a path made of non-empty segments separated by single slashes and
+// optionally terminated by a slash. Returns false if the path does not follow
+// this pattern.
+bool SplitSegments(const std::string &sPath,
+                   std::vector<std::string> &segments);
+
+// Whether a path made of non-empty segments separated by single slashes stays
+// below the directory it is relative to: none of its segments is "." or "..",
+// nor contains a backslash, which is a separator on Windows
+bool IsSafeRelativePath(const std::string &sPath);
+} // namespace path
+
+namespace url {
+// Storage service of the host of a cloud URL. Returns false if the host is
+// neither a blob nor a file storage endpoint.
+bool GetStorageType(const std::string &sHost, StorageType &storageType);
+} // namespace url
+
 namespace glob {
 size_t FindGlobbingChar(const std::string &str);
 }
+
+namespace localfs {
+// Relative paths, with slashes as separators, of the regular files of a local
+// directory and of its subdirectories
+std::vector<std::string> ListFilesRecursively(const std::string &sDir);
+// Creates a local directory and its missing parents
+void MakeDirs(const std::string &sDir);
+// Modification time of a local file, in the finest unit recorded by the
+// platform: nanoseconds, or 100 nanoseconds on Windows
+uint64_t GetModificationTime(const std::string &sPath);
+
+// Existing local file opened once for writes at given offsets, which several
+// threads can make at once without sharing a position
+class PositionalFile {
+public:
+  explicit PositionalFile(const std::string &sPath);
+  ~PositionalFile();
+
+  PositionalFile(const PositionalFile &) = delete;
+  PositionalFile &operator=(const PositionalFile &) = delete;
+
+  void WriteAt(size_t nOffset, const void *source, size_t nSize) const;
+
+private:
+  std::string sPath;
+  intptr_t handle; // file descriptor, or HANDLE on Windows
+};
+} // namespace localfs
 } // namespace util
 } // namespace az
@@ -2,6 +2,7 @@
 #include "driver.hpp"
 #include "fixtures/storage_test.hpp"
 #include "returnval.hpp"
+#include "settings.hpp"
 
 #include <cstring>
 #include <fstream>
@@ -186,3 +187,54 @@ TEST_F(ShareStorageTest, RmDir) {
   ASSERT_EQ(driver_dirExists(sNewDir.c_str()), nFalse);
   ASSERT_EQ(driver_disconnect(), nSuccess);
 }
+
+TEST_P(CommonStorageTest, RemoveMatchingFiles) {
+  std::string sDir = url.NewRandomDir();
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_mkdir(sDir.c_str()), nSuccess);
+  for (int i = 0; i < 5; i++) {
+    std::string sFile = sDir + "file-" + std::to_string(i) + ".txt";
+    ASSERT_NE(handle = driver_fopen(sFile.c_str(), 'w'), nullptr);
+    ASSERT_EQ(driver_fwrite("abc", 1, 3, handle), 3);
+    ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  }
+
+  // All the files matching the pattern are deleted at once
+  ASSERT_EQ(driver_remove((sDir + "file-*.txt").c_str()), nSuccess);
+  ASSERT_EQ(driver_fileExists((sDir + "file-0.txt").c_str()), nFalse);
+  ASSERT_EQ(driver_fileExists((sDir + "file-4.txt").c_str()), nFalse);
+  ASSERT_EQ(driver_remove((sDir + "file-*.txt").c_str()), nFailure);
+
+  ASSERT_EQ(driver_rmdir(sDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+#ifndef _WIN32
+// Setting of environment variables does not work on Windows
+TEST_F(ShareStorageTest, RmDirRecursively) {
+  std::string sDir = url.NewRandomDir();
+  std::string sSubdir = sDir + "sub/";
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_mkdir(sDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_mkdir(sSubdir.c_str()), nSuccess);
+  for (const auto &sFile : {sDir + "a.txt", sSubdir + "b.txt"}) {
+    ASSERT_NE(handle = driver_fopen(sFile.c_str(), 'w'), nullptr);
+    ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  }
+
+  // Directories are only removed with their content once enabled, by rmdir
+  // as well as by the removal of a pattern matching them
+  ASSERT_EQ(driver_rmdir(sDir.c_str()), nFailure);
+  ScopedSetting recursiveDelete("AZURE_RECURSIVE_DELETE", "true");
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_remove((sDir + "su*").c_str()), nSuccess);
+  ASSERT_EQ(driver_dirExists(sSubdir.c_str()), nFalse);
+  ASSERT_EQ(driver_fileExists((sDir + "a.txt").c_str()), nTrue);
+  ASSERT_EQ(driver_rmdir(sDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_dirExists(sDir.c_str()), nFalse);
+
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+#endif
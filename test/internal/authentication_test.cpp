@@ -0,0 +1,67 @@
+#include "../../src/authentication.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace std;
+using az::Authentication;
+
+static const string sBlobUrl = "https://account.blob.core.windows.net:443";
+static const string sOtherBlobUrl = "https://other.blob.core.windows.net:443";
+static const string sFileUrl = "https://account.file.core.windows.net:443";
+
+TEST(AuthenticationTest, EmulatorKey) {
+  az::Config config;
+  config.sStorageAccountKey = "key";
+  ASSERT_EQ(az::GetAuthentication(config, "http://127.0.0.1:10000/account",
+                                  true),
+            Authentication::EMULATOR_KEY);
+}
+
+TEST(AuthenticationTest, StorageTokenWithoutLocalSigning) {
+  az::Config config;
+  ASSERT_EQ(az::GetAuthentication(config, sBlobUrl, false),
+            Authentication::STORAGE_TOKEN);
+  ASSERT_EQ(az::GetServiceClientUrl(config, sBlobUrl,
+                                    Authentication::STORAGE_TOKEN),
+            sBlobUrl);
+}
+
+TEST(AuthenticationTest, AccountKeyScopedToItsAccount) {
+  az::Config config;
+  config.sStorageAccountName = "account";
+  config.sStorageAccountKey = "key";
+  ASSERT_EQ(az::GetAuthentication(config, sBlobUrl, false),
+            Authentication::ACCOUNT_KEY);
+  ASSERT_EQ(az::GetAuthentication(config, sFileUrl, false),
+            Authentication::ACCOUNT_KEY);
+  ASSERT_EQ(az::GetAuthentication(config, sOtherBlobUrl, false),
+            Authentication::STORAGE_TOKEN);
+  ASSERT_EQ(
+      az::GetServiceClientUrl(config, sBlobUrl, Authentication::ACCOUNT_KEY),
+      sBlobUrl);
+}
+
+TEST(AuthenticationTest, SasTokenScopedToItsAccount) {
+  az::Config config;
+  config.sStorageAccountName = "account";
+  config.sStorageSasToken = "sv=2022-11-02&sig=abc";
+  ASSERT_EQ(az::GetAuthentication(config, sBlobUrl, false),
+            Authentication::SAS_TOKEN);
+  ASSERT_EQ(az::GetAuthentication(config, sOtherBlobUrl, false),
+            Authentication::STORAGE_TOKEN);
+  ASSERT_EQ(
+      az::GetServiceClientUrl(config, sBlobUrl, Authentication::SAS_TOKEN),
+      sBlobUrl + "?sv=2022-11-02&sig=abc");
+  ASSERT_EQ(az::GetServiceClientUrl(config, sOtherBlobUrl,
+                                    Authentication::STORAGE_TOKEN),
+            sOtherBlobUrl);
+}
+
+TEST(AuthenticationTest, SasTokenForAllAccounts) {
+  az::Config config;
+  config.sStorageSasToken = "sv=2022-11-02&sig=abc";
+  ASSERT_EQ(az::GetAuthentication(config, sBlobUrl, false),
+            Authentication::SAS_TOKEN);
+  ASSERT_EQ(az::GetAuthentication(config, sOtherBlobUrl, false),
+            Authentication::SAS_TOKEN);
+}
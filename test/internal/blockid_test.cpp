@@ -0,0 +1,51 @@
+#include "../../src/blockid.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(BlockIdTest, SameLengthForAllBlockIds) {
+  ASSERT_EQ(az::MakeBlockId(0).size(), az::MakeBlockId(123456789).size());
+  ASSERT_EQ(az::MakeBlockId(0).size(), az::MakePartBlockId(12, 34, 56).size());
+  ASSERT_EQ(az::MakeBlockId(0).size(),
+            az::MakeUploadBlockId(12, 34, 4000ULL * 1024 * 1024, 56).size());
+}
+
+TEST(BlockIdTest, NextBlockIndexFollowsLargestIndex) {
+  ASSERT_EQ(az::GetNextBlockIndex({}), 0u);
+  ASSERT_EQ(az::GetNextBlockIndex({az::MakeBlockId(7), az::MakeBlockId(2)}),
+            8u);
+  // foreign and part block IDs are only counted
+  ASSERT_EQ(az::GetNextBlockIndex({"Zm9yZWlnbg==", az::MakeBlockId(0),
+                                   az::MakePartBlockId(3, 1, 9),
+                                   az::MakeUploadBlockId(3, 1, 2, 9)}),
+            4u);
+}
+
+TEST(BlockIdTest, UploadBlockIdsDependOnBlockSize) {
+  ASSERT_NE(az::MakeUploadBlockId(100, 7, 8, 12),
+            az::MakeUploadBlockId(100, 7, 4, 12));
+}
+
+TEST(BlockIdTest, PartBlockIdsInBlobOrder) {
+  vector<string> blockIds = {
+      az::MakePartBlockId(1, 5, 0), az::MakePartBlockId(0, 5, 1),
+      az::MakeBlockId(0),           az::MakePartBlockId(10, 5, 0),
+      az::MakePartBlockId(0, 5, 0), az::MakePartBlockId(1, 5, 10),
+      az::MakePartBlockId(1, 5, 2), az::MakeUploadBlockId(0, 5, 1, 0)};
+  ASSERT_EQ(az::GetPartBlockIds(blockIds),
+            (vector<string>{
+                az::MakePartBlockId(0, 5, 0), az::MakePartBlockId(0, 5, 1),
+                az::MakePartBlockId(1, 5, 0), az::MakePartBlockId(1, 5, 2),
+                az::MakePartBlockId(1, 5, 10), az::MakePartBlockId(10, 5, 0)}));
+}
+
+TEST(BlockIdTest, LastAttemptAtEachPart) {
+  vector<string> blockIds = {
+      az::MakePartBlockId(0, 1, 0), az::MakePartBlockId(0, 1, 1),
+      az::MakePartBlockId(0, 2, 0), az::MakePartBlockId(1, 1, 0)};
+  ASSERT_EQ(az::GetPartBlockIds(blockIds),
+            (vector<string>{az::MakePartBlockId(0, 2, 0),
+                            az::MakePartBlockId(1, 1, 0)}));
+}
@@ -0,0 +1,66 @@
+#include "../../src/checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace std;
+
+static const string sCheckpointPath = "checkpoint_test.checkpoint";
+
+TEST(CheckpointTest, ResumeCompletedRanges) {
+  {
+    az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+    ASSERT_FALSE(checkpoint.IsResumed());
+    checkpoint.MarkDone(0);
+    checkpoint.MarkDone(16);
+  }
+  az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+  ASSERT_TRUE(checkpoint.IsResumed());
+  ASSERT_TRUE(checkpoint.IsDone(0));
+  ASSERT_TRUE(checkpoint.IsDone(16));
+  ASSERT_FALSE(checkpoint.IsDone(8));
+  checkpoint.Remove();
+  ASSERT_FALSE(ifstream(sCheckpointPath).good());
+}
+
+TEST(CheckpointTest, RestartForOtherKey) {
+  {
+    az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+    checkpoint.MarkDone(0);
+  }
+  az::TransferCheckpoint checkpoint(sCheckpointPath, "other key", true);
+  ASSERT_FALSE(checkpoint.IsResumed());
+  ASSERT_FALSE(checkpoint.IsDone(0));
+  checkpoint.Remove();
+}
+
+TEST(CheckpointTest, RestartWithoutResuming) {
+  {
+    az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+    checkpoint.MarkDone(0);
+  }
+  az::TransferCheckpoint checkpoint(sCheckpointPath, "key", false);
+  ASSERT_FALSE(checkpoint.IsResumed());
+  ASSERT_FALSE(checkpoint.IsDone(0));
+  checkpoint.Remove();
+}
+
+TEST(CheckpointTest, IgnorePartiallyRecordedRange) {
+  {
+    ofstream ofs(sCheckpointPath);
+    ofs << "key\n8\n1";
+  }
+  {
+    az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+    ASSERT_TRUE(checkpoint.IsResumed());
+    ASSERT_TRUE(checkpoint.IsDone(8));
+    ASSERT_FALSE(checkpoint.IsDone(1));
+    checkpoint.MarkDone(6);
+  }
+  az::TransferCheckpoint checkpoint(sCheckpointPath, "key", true);
+  ASSERT_TRUE(checkpoint.IsDone(6));
+  ASSERT_FALSE(checkpoint.IsDone(16));
+  ASSERT_FALSE(checkpoint.IsDone(1));
+  checkpoint.Remove();
+}
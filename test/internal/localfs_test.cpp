@@ -0,0 +1,40 @@
+#include "../../src/util.hpp"
+#include <algorithm>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(LocalFsTest, ListFilesOfCreatedDirs) {
+  const string sDir = "localfs_test_dir";
+  az::util::localfs::MakeDirs(sDir + "/sub/subsub");
+  az::util::localfs::MakeDirs(sDir + "/sub"); // already existing
+  ofstream(sDir + "/a.txt") << "a";
+  ofstream(sDir + "/sub/b.txt") << "b";
+  ofstream(sDir + "/sub/subsub/c.txt") << "c";
+
+  vector<string> files = az::util::localfs::ListFilesRecursively(sDir);
+  sort(files.begin(), files.end());
+  ASSERT_EQ(files,
+            (vector<string>{"a.txt", "sub/b.txt", "sub/subsub/c.txt"}));
+}
+
+TEST(LocalFsTest, WriteAtOffsets) {
+  const string sPath = "localfs_test_positional.txt";
+  ofstream(sPath) << "......";
+  {
+    az::util::localfs::PositionalFile file(sPath);
+    file.WriteAt(4, "ef", 2);
+    file.WriteAt(0, "ab", 2);
+  }
+  string sContent;
+  getline(ifstream(sPath), sContent);
+  ASSERT_EQ(sContent, "ab..ef");
+}
+
+TEST(LocalFsTest, ListFilesOfMissingDir) {
+  ASSERT_THROW(az::util::localfs::ListFilesRecursively("localfs_test_none"),
+               az::LocalFileError);
+}
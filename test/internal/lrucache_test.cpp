@@ -0,0 +1,44 @@
+#include "../../src/lrucache.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(LruCacheTest, FindInsertedValue) {
+  az::LruCache<std::string, int> cache(2);
+  int nValue = 0;
+  ASSERT_FALSE(cache.Find("a", nValue));
+  cache.Insert("a", 1);
+  ASSERT_TRUE(cache.Find("a", nValue));
+  ASSERT_EQ(nValue, 1);
+}
+
+TEST(LruCacheTest, EvictLeastRecentlyUsed) {
+  az::LruCache<std::string, int> cache(2);
+  int nValue = 0;
+  cache.Insert("a", 1);
+  cache.Insert("b", 2);
+  ASSERT_TRUE(cache.Find("a", nValue)); // "b" becomes the least recently used
+  cache.Insert("c", 3);
+  ASSERT_EQ(cache.GetSize(), 2ULL);
+  ASSERT_FALSE(cache.Find("b", nValue));
+  ASSERT_TRUE(cache.Find("a", nValue));
+  ASSERT_EQ(nValue, 1);
+  ASSERT_TRUE(cache.Find("c", nValue));
+  ASSERT_EQ(nValue, 3);
+}
+
+TEST(LruCacheTest, ReplaceValue) {
+  az::LruCache<std::string, int> cache(2);
+  int nValue = 0;
+  cache.Insert("a", 1);
+  cache.Insert("a", 2);
+  ASSERT_EQ(cache.GetSize(), 1ULL);
+  ASSERT_TRUE(cache.Find("a", nValue));
+  ASSERT_EQ(nValue, 2);
+}
+
+TEST(LruCacheTest, ZeroCapacityDisablesCache) {
+  az::LruCache<std::string, int> cache(0);
+  int nValue = 0;
+  cache.Insert("a", 1);
+  ASSERT_FALSE(cache.Find("a", nValue));
+}
@@ -0,0 +1,79 @@
+#include "../../src/util.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+TEST(PathTest, SplitLeadingSegmentsOfEmulatedBlobPath) {
+  vector<string> parts;
+  ASSERT_TRUE(az::util::path::SplitLeadingSegments(
+      "devstoreaccount1/container/path/to/object", 2, parts));
+  ASSERT_EQ(parts, (vector<string>{"devstoreaccount1", "container",
+                                   "path/to/object"}));
+}
+
+TEST(PathTest, SplitLeadingSegmentsOfBlobDirPath) {
+  vector<string> parts;
+  ASSERT_TRUE(
+      az::util::path::SplitLeadingSegments("container/path/to/dir/", 1, parts));
+  ASSERT_EQ(parts, (vector<string>{"container", "path/to/dir/"}));
+}
+
+TEST(PathTest, SplitLeadingSegmentsFailures) {
+  vector<string> parts;
+  ASSERT_FALSE(az::util::path::SplitLeadingSegments("container", 1, parts));
+  ASSERT_FALSE(az::util::path::SplitLeadingSegments("container/", 1, parts));
+  ASSERT_FALSE(az::util::path::SplitLeadingSegments("/object", 1, parts));
+  ASSERT_FALSE(
+      az::util::path::SplitLeadingSegments("account//object", 2, parts));
+}
+
+TEST(PathTest, SplitSegments) {
+  vector<string> segments;
+  ASSERT_TRUE(az::util::path::SplitSegments("path/to/a/file", segments));
+  ASSERT_EQ(segments, (vector<string>{"path", "to", "a", "file"}));
+  ASSERT_TRUE(az::util::path::SplitSegments("path/to/a/dir/", segments));
+  ASSERT_EQ(segments, (vector<string>{"path", "to", "a", "dir"}));
+}
+
+TEST(PathTest, SplitSegmentsFailures) {
+  vector<string> segments;
+  ASSERT_FALSE(az::util::path::SplitSegments("", segments));
+  ASSERT_FALSE(az::util::path::SplitSegments("/file", segments));
+  ASSERT_FALSE(az::util::path::SplitSegments("path//file", segments));
+  ASSERT_FALSE(az::util::path::SplitSegments("dir//", segments));
+}
+
+TEST(PathTest, IsSafeRelativePath) {
+  ASSERT_TRUE(az::util::path::IsSafeRelativePath("file.txt"));
+  ASSERT_TRUE(az::util::path::IsSafeRelativePath("path/to/..file.txt"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath(""));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("/etc/passwd"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("path//file.txt"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("path/to/dir/"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("../file.txt"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("path/../../file.txt"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("path/./file.txt"));
+  ASSERT_FALSE(az::util::path::IsSafeRelativePath("..\\file.txt"));
+}
+
+TEST(PathTest, GetStorageType) {
+  az::StorageType storageType;
+  ASSERT_TRUE(az::util::url::GetStorageType("account.blob.core.windows.net",
+                                            storageType));
+  ASSERT_EQ(storageType, az::BLOB);
+  ASSERT_TRUE(az::util::url::GetStorageType("account.file.core.windows.net",
+                                            storageType));
+  ASSERT_EQ(storageType, az::SHARE);
+  ASSERT_FALSE(az::util::url::GetStorageType("file.example.com", storageType));
+  ASSERT_FALSE(az::util::url::GetStorageType(
+      "account.file.core.windows.net.example.com", storageType));
+}
+
+TEST(PathTest, FindGlobbingChar) {
+  ASSERT_EQ(az::util::glob::FindGlobbingChar("Adult-split-*.txt"), 12ULL);
+  ASSERT_EQ(az::util::glob::FindGlobbingChar("Adult-split-\\*.txt"),
+            string::npos);
+  ASSERT_EQ(az::util::glob::FindGlobbingChar("Adult.txt"), string::npos);
+}
@@ -0,0 +1,56 @@
+#include "../../src/taskgroup.hpp"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+TEST(TaskGroupTest, RunAllTasks) {
+  az::TaskGroup tasks(4);
+  std::atomic<int> nRun(0);
+  for (int i = 0; i < 100; i++)
+    tasks.Submit([&nRun]() { nRun++; });
+  tasks.Wait();
+  ASSERT_EQ(nRun, 100);
+}
+
+TEST(TaskGroupTest, BoundConcurrency) {
+  az::TaskGroup tasks(3);
+  std::atomic<int> nRunning(0);
+  std::atomic<int> nMaxRunning(0);
+  for (int i = 0; i < 20; i++) {
+    tasks.Submit([&nRunning, &nMaxRunning]() {
+      int nNowRunning = ++nRunning;
+      int nMax = nMaxRunning;
+      while (nNowRunning > nMax &&
+             !nMaxRunning.compare_exchange_weak(nMax, nNowRunning)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      nRunning--;
+    });
+  }
+  tasks.Wait();
+  ASSERT_LE(nMaxRunning, 3);
+}
+
+TEST(TaskGroupTest, RethrowFirstErrorOnWait) {
+  az::TaskGroup tasks(2);
+  tasks.Submit([]() { throw std::runtime_error("failed"); });
+  ASSERT_THROW(tasks.Wait(), std::runtime_error);
+  // the error is reported once
+  tasks.Submit([]() {});
+  ASSERT_NO_THROW(tasks.Wait());
+}
+
+TEST(TaskGroupTest, RunInlineWithoutConcurrency) {
+  az::TaskGroup tasks(1);
+  std::thread::id taskThreadId;
+  tasks.Submit(
+      [&taskThreadId]() { taskThreadId = std::this_thread::get_id(); });
+  tasks.Wait();
+  ASSERT_EQ(taskThreadId, std::this_thread::get_id());
+
+  ASSERT_THROW(tasks.Submit([]() { throw std::runtime_error("failed"); }),
+               std::runtime_error);
+  ASSERT_THROW(tasks.Wait(), std::runtime_error);
+}
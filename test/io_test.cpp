@@ -2,7 +2,10 @@
 #include "driver.hpp"
 #include "fixtures/storage_test.hpp"
 #include "returnval.hpp"
+#include "settings.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <functional>
@@ -139,3 +142,504 @@ TEST_P(IoTest, FReadWithConcurrentWrite) {
 
   ASSERT_EQ(driver_disconnect(), nSuccess);
 }
+
+// Text made of a header line followed by nLines numbered lines
+static string MakeLines(size_t nLines) {
+  ostringstream os;
+  os << "Label\tValue\n";
+  for (size_t i = 0; i < nLines; i++)
+    os << "line\t" << i << "\n";
+  return os.str();
+}
+
+// Writes a file through the driver, by writes of at most nChunkSize bytes
+static void WriteFile(const string &sUrl, const string &sContent, char mode,
+                      size_t nChunkSize) {
+  void *handle;
+  ASSERT_NE(handle = driver_fopen(sUrl.c_str(), mode), nullptr);
+  for (size_t nPos = 0; nPos < sContent.size(); nPos += nChunkSize) {
+    size_t nToWrite = min(nChunkSize, sContent.size() - nPos);
+    ASSERT_EQ(driver_fwrite(sContent.data() + nPos, 1, nToWrite, handle),
+              (long long int)nToWrite);
+  }
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+}
+
+// Content of a file read through the driver, empty if it cannot be read
+static string ReadFile(const string &sUrl) {
+  long long int nSize = driver_getFileSize(sUrl.c_str());
+  if (nSize <= 0)
+    return "";
+  string sContent((size_t)nSize, '\0');
+  void *handle = driver_fopen(sUrl.c_str(), 'r');
+  if (handle == nullptr)
+    return "";
+  long long int nRead = driver_fread(&sContent[0], 1, sContent.size(), handle);
+  driver_fclose(handle);
+  return nRead == nSize ? sContent : "";
+}
+
+// Content of a local file, empty if it cannot be read
+static string ReadLocalFile(const string &sPath) {
+  ostringstream os;
+  os << ifstream(sPath, ios::binary).rdbuf();
+  return os.str();
+}
+
+TEST_P(IoTest, SizeAfterFlush) {
+  string file = url.RandomOutputFile();
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // Share files are allocated ahead of the writes, which is not visible once
+  // they are flushed
+  ASSERT_NE(handle = driver_fopen(file.c_str(), 'w'), nullptr);
+  ASSERT_EQ(driver_fwrite("abc", 1, 3, handle), 3);
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(driver_getFileSize(file.c_str()), 3);
+  ASSERT_EQ(ReadFile(file), "abc");
+  ASSERT_EQ(driver_fwrite("defg", 1, 4, handle), 4);
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(driver_getFileSize(file.c_str()), 7);
+  ASSERT_EQ(ReadFile(file), "abcdefg");
+  ASSERT_EQ(driver_fwrite("h", 1, 1, handle), 1);
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  ASSERT_EQ(driver_getFileSize(file.c_str()), 8);
+  ASSERT_EQ(ReadFile(file), "abcdefgh");
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, AppendToSmallFile) {
+  string file = url.RandomOutputFile();
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // Small blobs are uploaded in a single request, without blocks, their
+  // content being kept by the appends
+  WriteFile(file, "abc\n", 'w', 4);
+  WriteFile(file, "def\n", 'a', 4);
+  ASSERT_EQ(ReadFile(file), "abc\ndef\n");
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, WriteParts) {
+  string file = url.RandomOutputFile();
+  void *firstPart;
+  void *secondPart;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  if (GetParam() == SHARE) {
+    ASSERT_EQ(driver_fopenPart(file.c_str(), 0), nullptr);
+    ASSERT_EQ(driver_commitParts(file.c_str()), nFailure);
+    ASSERT_EQ(driver_disconnect(), nSuccess);
+    return;
+  }
+
+  // The parts are written in any order, and only become the content of the
+  // file once committed, in the order of their indices
+  ASSERT_NE(secondPart = driver_fopenPart(file.c_str(), 1), nullptr);
+  ASSERT_NE(firstPart = driver_fopenPart(file.c_str(), 0), nullptr);
+  ASSERT_EQ(driver_fwrite("def\n", 1, 4, secondPart), 4);
+  ASSERT_EQ(driver_fwrite("abc\n", 1, 4, firstPart), 4);
+  ASSERT_EQ(driver_fclose(secondPart), nCloseSuccess);
+  ASSERT_EQ(driver_fclose(firstPart), nCloseSuccess);
+  ASSERT_EQ(driver_fileExists(file.c_str()), nFalse);
+  ASSERT_EQ(driver_commitParts(file.c_str()), nSuccess);
+  ASSERT_EQ(ReadFile(file), "abc\ndef\n");
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, Concatenate) {
+  string file = url.RandomOutputFile();
+  string sMultipartFile = url.BQFile();
+  string sLargeFile = url.File();
+  string sFirstPart = url.BQSomeFilePart();
+  string sSecondPart = url.BQShortFilePart();
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // A single input is copied, its fragments being merged with their
+  // header kept only once
+  const char *multipartInput[] = {sMultipartFile.c_str()};
+  ASSERT_EQ(driver_concat(file.c_str(), multipartInput, 1), nSuccess);
+  ASSERT_EQ(ReadFile(file), ReadFile(sMultipartFile));
+
+  // The header of the inputs is only kept at the start of the output
+  const string sFirstContent = ReadFile(sFirstPart);
+  const string sSecondContent = ReadFile(sSecondPart);
+  const size_t nHeaderLen = sFirstContent.find('\n') + 1;
+  const char *partInputs[] = {sFirstPart.c_str(), sSecondPart.c_str()};
+  ASSERT_EQ(driver_concat(file.c_str(), partInputs, 2), nSuccess);
+  ASSERT_EQ(ReadFile(file), sFirstContent + sSecondContent.substr(nHeaderLen));
+
+  // Inputs larger than the ranges copied at once by share files
+  const string sLargeContent = ReadFile(sLargeFile);
+  const char *largeInputs[] = {sLargeFile.c_str(), sLargeFile.c_str()};
+  ASSERT_EQ(driver_concat(file.c_str(), largeInputs, 2), nSuccess);
+  ASSERT_EQ(ReadFile(file),
+            sLargeContent + sLargeContent.substr(sLargeContent.find('\n') + 1));
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, CopyAndMove) {
+  string copiedFile = url.RandomOutputFile();
+  string movedFile = url.RandomOutputFile();
+  ASSERT_EQ(driver_connect(), nSuccess);
+  const string sContent = ReadFile(url.File());
+  ASSERT_EQ(sContent.size(), (size_t)5585568);
+
+  // Both single and multipart files are copied as single files
+  ASSERT_EQ(driver_copy(url.File().c_str(), copiedFile.c_str()), nSuccess);
+  ASSERT_EQ(ReadFile(copiedFile), sContent);
+  ASSERT_EQ(driver_copy(url.BQFile().c_str(), copiedFile.c_str()), nSuccess);
+  ASSERT_EQ(ReadFile(copiedFile), sContent);
+
+  ASSERT_EQ(driver_move(copiedFile.c_str(), movedFile.c_str()), nSuccess);
+  ASSERT_EQ(driver_fileExists(copiedFile.c_str()), nFalse);
+  ASSERT_EQ(ReadFile(movedFile), sContent);
+
+  ASSERT_EQ(driver_copy(url.InexistantFile().c_str(), copiedFile.c_str()),
+            nFailure);
+  ASSERT_EQ(driver_remove(movedFile.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, CopyAll) {
+  string sSourceDir = url.NewRandomDir();
+  string sDestDir = url.NewRandomDir();
+  string sLocalDir = sLocalFilePath + ".d";
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_mkdir(sSourceDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_mkdir(sDestDir.c_str()), nSuccess);
+  WriteFile(sSourceDir + "a.txt", "abc\n", 'w', 4);
+  WriteFile(sSourceDir + "b.txt", "def\n", 'w', 4);
+  WriteFile(sSourceDir + "c%20d%231.txt", "ghi\n", 'w', 4);
+
+  // The files are copied at their path relative to the directory of the
+  // pattern, and then back from the local directory, with their names decoded
+  // from and encoded in URLs
+  ASSERT_EQ(driver_copyAllToLocal((sSourceDir + "*.txt").c_str(),
+                                  sLocalDir.c_str()),
+            nSuccess);
+  ASSERT_EQ(ReadLocalFile(sLocalDir + "/a.txt"), "abc\n");
+  ASSERT_EQ(ReadLocalFile(sLocalDir + "/b.txt"), "def\n");
+  ASSERT_EQ(ReadLocalFile(sLocalDir + "/c d#1.txt"), "ghi\n");
+  ASSERT_EQ(driver_copyAllFromLocal(sLocalDir.c_str(), sDestDir.c_str()),
+            nSuccess);
+  ASSERT_EQ(ReadFile(sDestDir + "a.txt"), "abc\n");
+  ASSERT_EQ(ReadFile(sDestDir + "b.txt"), "def\n");
+  ASSERT_EQ(ReadFile(sDestDir + "c%20d%231.txt"), "ghi\n");
+
+  ASSERT_EQ(driver_copyAllToLocal((sSourceDir + "none*.txt").c_str(),
+                                  sLocalDir.c_str()),
+            nFailure);
+  remove((sLocalDir + "/a.txt").c_str());
+  remove((sLocalDir + "/b.txt").c_str());
+  remove((sLocalDir + "/c d#1.txt").c_str());
+  remove(sLocalDir.c_str());
+  for (const auto &sDir : {sSourceDir, sDestDir}) {
+    ASSERT_EQ(driver_remove((sDir + "*.txt").c_str()), nSuccess);
+    ASSERT_EQ(driver_rmdir(sDir.c_str()), nSuccess);
+  }
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+#ifndef _WIN32
+// Setting of environment variables does not work on Windows
+void TestBlockedWrite(string sUrl, const char *sWriteConcurrency);
+void TestFlushPolicy(string sUrl, const char *sFlushPolicy,
+                     bool bVisibleOnFlush);
+
+TEST_P(IoTest, WriteLargerThanBlockSize) {
+  TestBlockedWrite(url.RandomOutputFile(), "1");
+}
+
+TEST_P(IoTest, WriteBlocksConcurrently) {
+  TestBlockedWrite(url.RandomOutputFile(), "4");
+}
+
+void TestBlockedWrite(string sUrl, const char *sWriteConcurrency) {
+  ScopedSetting blockSize("AZURE_WRITE_BLOCK_SIZE", "1024");
+  ScopedSetting writeConcurrency("AZURE_WRITE_CONCURRENCY", sWriteConcurrency);
+  ASSERT_EQ(driver_connect(), nSuccess);
+  const string sContent = MakeLines(1000);
+
+  // Writes smaller than the blocks, which do not align with them
+  WriteFile(sUrl, sContent, 'w', 100);
+  ASSERT_EQ(ReadFile(sUrl), sContent);
+  // A single write of several blocks
+  WriteFile(sUrl, sContent, 'w', sContent.size());
+  ASSERT_EQ(ReadFile(sUrl), sContent);
+
+  ASSERT_EQ(driver_remove(sUrl.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, FlushPolicyAlways) {
+  TestFlushPolicy(url.RandomOutputFile(), "always", true);
+}
+
+TEST_P(IoTest, FlushPolicyChanged) {
+  TestFlushPolicy(url.RandomOutputFile(), "changed", true);
+}
+
+TEST_P(IoTest, FlushPolicyClose) {
+  // share files are always written through on flush
+  TestFlushPolicy(url.RandomOutputFile(), "close", GetParam() == SHARE);
+}
+
+TEST_P(IoTest, FlushPartialBlocks) {
+  ScopedSetting writeBlockSize("AZURE_WRITE_BLOCK_SIZE", "4");
+  string sUrl = url.RandomOutputFile();
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // The partial block committed by a flush is completed by the next writes
+  ASSERT_NE(handle = driver_fopen(sUrl.c_str(), 'w'), nullptr);
+  ASSERT_EQ(driver_fwrite("ab", 1, 2, handle), 2);
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(ReadFile(sUrl), "ab");
+  ASSERT_EQ(driver_fwrite("cdef", 1, 4, handle), 4);
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(ReadFile(sUrl), "abcdef");
+  ASSERT_EQ(driver_fwrite("gh", 1, 2, handle), 2);
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  ASSERT_EQ(ReadFile(sUrl), "abcdefgh");
+
+  ASSERT_EQ(driver_remove(sUrl.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+void TestFlushPolicy(string sUrl, const char *sFlushPolicy,
+                     bool bVisibleOnFlush) {
+  ScopedSetting flushPolicy("AZURE_FLUSH_POLICY", sFlushPolicy);
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  ASSERT_NE(handle = driver_fopen(sUrl.c_str(), 'w'), nullptr);
+  ASSERT_EQ(driver_fwrite("abc", 1, 3, handle), 3);
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(ReadFile(sUrl), bVisibleOnFlush ? "abc" : "");
+  // Nothing was written since the previous flush
+  ASSERT_EQ(driver_fflush(handle), nFlushSuccess);
+  ASSERT_EQ(driver_fwrite("def", 1, 3, handle), 3);
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  ASSERT_EQ(ReadFile(sUrl), "abcdef");
+
+  ASSERT_EQ(driver_remove(sUrl.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, AsyncClose) {
+  ScopedSetting asyncClose("AZURE_ASYNC_CLOSE", "true");
+  string file = url.RandomOutputFile();
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  WriteFile(file, "abc", 'w', 3);
+  // The file is complete once the driver is synced
+  ASSERT_EQ(driver_sync(), nSuccess);
+  ASSERT_EQ(ReadFile(file), "abc");
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_F(BlobStorageTest, AsyncCloseFailure) {
+  ScopedSetting asyncClose("AZURE_ASYNC_CLOSE", "true");
+  string file = url.InexistantContainerFile();
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // The blob is only written to its missing container when closed, the
+  // failure being reported by the next sync, and only by it
+  ASSERT_NE(handle = driver_fopen(file.c_str(), 'w'), nullptr);
+  ASSERT_EQ(driver_fwrite("abc", 1, 3, handle), 3);
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  ASSERT_EQ(driver_sync(), nFailure);
+  ASSERT_STRNE(driver_getlasterror(), NULL);
+  ASSERT_EQ(driver_sync(), nSuccess);
+
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, AppendToAppendBlob) {
+  if (GetParam() == SHARE)
+    GTEST_SKIP() << "append blobs are only written to blob storages";
+  ScopedSetting appendBlobs("AZURE_APPEND_BLOBS", "true");
+  string file = url.RandomOutputFile();
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // The file is created by the first append
+  WriteFile(file, "abc\n", 'a', 4);
+  WriteFile(file, "def\n", 'a', 4);
+  ASSERT_EQ(ReadFile(file), "abc\ndef\n");
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, AppendToCompactedBlob) {
+  if (GetParam() == SHARE)
+    GTEST_SKIP() << "share files are not made of blocks";
+  ScopedSetting compactionBlockCount("AZURE_COMPACTION_BLOCK_COUNT", "2");
+  string file = url.RandomOutputFile();
+  string sContent;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // Each append commits a block, the blocks being compacted once there are
+  // two of them
+  for (int i = 0; i < 5; i++) {
+    string sLine = "line " + to_string(i) + "\n";
+    WriteFile(file, sLine, 'a', sLine.size());
+    sContent += sLine;
+    ASSERT_EQ(ReadFile(file), sContent);
+  }
+
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, WriteShards) {
+  ScopedSetting shardSize("AZURE_SHARD_SIZE", "64");
+  string sDir = url.NewRandomDir();
+  string sPattern = sDir + "out-*.txt";
+  const string sContent = MakeLines(50);
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_mkdir(sDir.c_str()), nSuccess);
+
+  // The parts are numbered in place of the wildcard, each of them starting
+  // with the header, which is read only once from all of them
+  WriteFile(sPattern, sContent, 'w', 10);
+  ASSERT_EQ(driver_fileExists((sDir + "out-00.txt").c_str()), nTrue);
+  const string sPartStart = "Label\tValue\nline\t";
+  ASSERT_EQ(ReadFile(sDir + "out-01.txt").substr(0, sPartStart.size()),
+            sPartStart);
+  ASSERT_EQ(ReadFile(sPattern), sContent);
+
+  ASSERT_EQ(driver_remove(sPattern.c_str()), nSuccess);
+  ASSERT_EQ(driver_rmdir(sDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, CopyToLocalByRanges) {
+  ScopedSetting transferRangeSize("AZURE_TRANSFER_RANGE_SIZE", "1000000");
+  ScopedSetting transferConcurrency("AZURE_TRANSFER_CONCURRENCY", "4");
+  ASSERT_EQ(driver_connect(), nSuccess);
+  const string sContent = ReadFile(url.BQFile());
+  ASSERT_EQ(sContent.size(), (size_t)5585568);
+
+  // The ranges span the fragments of the file, whose repeated headers are
+  // skipped, and are written at their offset in the local file
+  ASSERT_EQ(
+      driver_copyToLocal(url.BQFile().c_str(), sLocalFilePath.c_str()),
+      nSuccess);
+  ASSERT_EQ(ReadLocalFile(sLocalFilePath), sContent);
+  // A longer local file is truncated to the size of the file
+  ofstream(sLocalFilePath, ios::binary) << sContent << sContent;
+  ASSERT_EQ(
+      driver_copyToLocal(url.BQFile().c_str(), sLocalFilePath.c_str()),
+      nSuccess);
+  ASSERT_EQ(ReadLocalFile(sLocalFilePath), sContent);
+
+  remove(sLocalFilePath.c_str());
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, CopyFromLocalByRanges) {
+  string file = url.RandomOutputFile();
+  ASSERT_EQ(driver_connect(), nSuccess);
+  const string sContent = ReadFile(url.File());
+  ofstream(sLocalFilePath, ios::binary) << sContent;
+
+  // The default ranges are larger than the 4 MiB share files accept at once
+  ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+            nSuccess);
+  ASSERT_EQ(ReadFile(file), sContent);
+  {
+    ScopedSetting transferRangeSize("AZURE_TRANSFER_RANGE_SIZE", "1000000");
+    ASSERT_EQ(driver_connect(), nSuccess);
+    ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+              nSuccess);
+    ASSERT_EQ(ReadFile(file), sContent);
+  }
+
+  remove(sLocalFilePath.c_str());
+  ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+            nFailure);
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, CopyAllByRanges) {
+  ScopedSetting transferRangeSize("AZURE_TRANSFER_RANGE_SIZE", "1000000");
+  string sPattern = url.File();
+  sPattern.replace(sPattern.rfind(".txt"), 4, "*.txt");
+  string sDestDir = url.NewRandomDir();
+  string sLocalDir = sLocalFilePath + ".d";
+  ASSERT_EQ(driver_connect(), nSuccess);
+  ASSERT_EQ(driver_mkdir(sDestDir.c_str()), nSuccess);
+  const string sContent = ReadFile(url.File());
+
+  // A large file of a bulk copy is still transferred by concurrent ranges
+  ASSERT_EQ(driver_copyAllToLocal(sPattern.c_str(), sLocalDir.c_str()),
+            nSuccess);
+  ASSERT_EQ(ReadLocalFile(sLocalDir + "/Adult.txt"), sContent);
+  ASSERT_EQ(driver_copyAllFromLocal(sLocalDir.c_str(), sDestDir.c_str()),
+            nSuccess);
+  ASSERT_EQ(ReadFile(sDestDir + "Adult.txt"), sContent);
+
+  ASSERT_EQ(driver_remove((sDestDir + "*.txt").c_str()), nSuccess);
+  ASSERT_EQ(driver_rmdir(sDestDir.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+
+TEST_P(IoTest, SyncTransfers) {
+  ScopedSetting syncTransfers("AZURE_SYNC_TRANSFERS", "true");
+  string file = url.RandomOutputFile();
+  string sCopyPath = sLocalFilePath + ".copy";
+  char buffer[8]{};
+  void *handle;
+  ASSERT_EQ(driver_connect(), nSuccess);
+
+  // Uploads are skipped while the file has the content of the local file, as
+  // seen by a reader which fails once the file is changed
+  ofstream(sLocalFilePath, ios::binary) << "abc\n";
+  ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+            nSuccess);
+  ASSERT_NE(handle = driver_fopen(file.c_str(), 'r'), nullptr);
+  ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+            nSuccess);
+  ASSERT_EQ(driver_fread(buffer, 1, 4, handle), 4);
+  ASSERT_STREQ(buffer, "abc\n");
+  ofstream(sLocalFilePath, ios::binary) << "defg\n";
+  ASSERT_EQ(driver_copyFromLocal(sLocalFilePath.c_str(), file.c_str()),
+            nSuccess);
+  ASSERT_EQ(driver_fseek(handle, 0, 0), nSeekSuccess);
+  ASSERT_EQ(driver_fread(buffer, 1, 4, handle), nReadFailure);
+  ASSERT_EQ(driver_fclose(handle), nCloseSuccess);
+  ASSERT_EQ(ReadFile(file), "defg\n");
+
+  // Downloads are recorded in a manifest next to the local file, and done
+  // again once the file is changed
+  ASSERT_EQ(driver_copyToLocal(file.c_str(), sCopyPath.c_str()), nSuccess);
+  ASSERT_EQ(ReadLocalFile(sCopyPath), "defg\n");
+  ASSERT_NE(ReadLocalFile(sCopyPath + ".sync"), "");
+  ASSERT_EQ(driver_copyToLocal(file.c_str(), sCopyPath.c_str()), nSuccess);
+  ASSERT_EQ(ReadLocalFile(sCopyPath), "defg\n");
+  WriteFile(file, "hi\n", 'w', 3);
+  ASSERT_EQ(driver_copyToLocal(file.c_str(), sCopyPath.c_str()), nSuccess);
+  ASSERT_EQ(ReadLocalFile(sCopyPath), "hi\n");
+
+  remove(sLocalFilePath.c_str());
+  remove(sCopyPath.c_str());
+  remove((sCopyPath + ".sync").c_str());
+  ASSERT_EQ(driver_remove(file.c_str()), nSuccess);
+  ASSERT_EQ(driver_disconnect(), nSuccess);
+}
+#endif
@@ -0,0 +1,23 @@
+#include "settings.hpp"
+#include <boost/process/v2/environment.hpp>
+#include <cstdlib>
+
+using namespace std;
+
+ScopedSetting::ScopedSetting(const string &sName, const string &sValue)
+    : sName(sName), bWasSet(false) {
+  const char *sCurrentValue = getenv(sName.c_str());
+  if (sCurrentValue) {
+    bWasSet = true;
+    sPreviousValue = sCurrentValue;
+  }
+  boost::process::v2::environment::set(sName.c_str(), sValue.c_str());
+}
+
+ScopedSetting::~ScopedSetting() {
+  if (bWasSet)
+    boost::process::v2::environment::set(sName.c_str(),
+                                         sPreviousValue.c_str());
+  else
+    boost::process::v2::environment::unset(sName.c_str());
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+class ScopedSetting;
+
+#include <string>
+
+// Driver setting, given by an environment variable, set for the lifetime of
+// the object and then restored. The driver reads its settings when it
+// connects.
+class ScopedSetting {
+public:
+  ScopedSetting(const std::string &sName, const std::string &sValue);
+  ~ScopedSetting();
+  ScopedSetting(const ScopedSetting &) = delete;
+  ScopedSetting &operator=(const ScopedSetting &) = delete;
+
+private:
+  std::string sName;
+  bool bWasSet;
+  std::string sPreviousValue;
+};
@@ -52,6 +52,11 @@ const string StorageTestUrlProvider::InexistantFile() const {
                    "non_existent_file.txt";
 }
 
+const string StorageTestUrlProvider::InexistantContainerFile() const {
+  return sPrefix + "/non-existent-container-khiops-driver-azure/"
+                   "non_existent_file.txt";
+}
+
 const string StorageTestUrlProvider::File() const {
   return sPrefix +
          "/data-test-khiops-driver-azure/khiops_data/samples/Adult/Adult.txt";
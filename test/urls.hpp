@@ -16,6 +16,7 @@ public:
   const std::string Dir() const;
   const std::string NewRandomDir() const;
   const std::string InexistantFile() const;
+  const std::string InexistantContainerFile() const;
   const std::string File() const;
   const std::string BQFile() const;
   const std::string BQSomeFilePart() const;